@@ -23,10 +23,8 @@
 
 #include <QObject>
 
-double AbstractMotion::m_damping = 0.;
-QVector<double> AbstractMotion::m_period = QVector<double>();
-
-AbstractMotion::AbstractMotion() {
+AbstractMotion::AbstractMotion(const SpectralContextPtr &context)
+    : m_context(context) {
     m_avgLnSa = -1;
     m_prevScale = 1.0;
     m_flag = Unmarked;
@@ -38,9 +36,9 @@ const QString &AbstractMotion::station() const { return m_station; }
 
 const QString &AbstractMotion::event() const { return m_event; }
 
-double AbstractMotion::damping() { return m_damping; }
+const SpectralContextPtr &AbstractMotion::context() const { return m_context; }
 
-void AbstractMotion::setDamping(const double damping) { m_damping = damping; }
+double AbstractMotion::damping() const { return m_context->damping(); }
 
 AbstractMotion::Flag AbstractMotion::flag() const { return m_flag; }
 
@@ -51,9 +49,9 @@ QList<QString> AbstractMotion::flags() {
                             << QObject::tr("Unmarked") << QObject::tr("Disabled");
 }
 
-const QVector<double> &AbstractMotion::period() { return m_period; }
-
-void AbstractMotion::setPeriod(QVector<double> &period) { m_period = period; }
+const QVector<double> &AbstractMotion::period() const {
+    return m_context->period();
+}
 
 const QVector<double> &AbstractMotion::sa() const { return m_sa; }
 
@@ -61,6 +59,8 @@ const QVector<double> &AbstractMotion::lnSa() const { return m_lnSa; }
 
 double AbstractMotion::avgLnSa() const { return m_avgLnSa; }
 
+double AbstractMotion::scale() const { return m_prevScale; }
+
 void AbstractMotion::scaleBy(const double factor) {
     // Scale factor relative to the previous
     const double relScale = factor / m_prevScale;
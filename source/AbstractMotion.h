@@ -19,6 +19,8 @@
 #ifndef ABSTRACT_MOTION_H_
 #define ABSTRACT_MOTION_H_
 
+#include "SpectralContext.h"
+
 #include <QList>
 #include <QString>
 #include <QVector>
@@ -33,7 +35,7 @@ public:
         Disabled, //<! Motion should not be used
     };
 
-    AbstractMotion();
+    AbstractMotion(const SpectralContextPtr &context);
 
     virtual ~AbstractMotion() = 0;
 
@@ -45,13 +47,18 @@ public:
 
     const QString &event() const;
 
-    static double damping();
+    //! Oscillators used to compute the response spectrum
+    const SpectralContextPtr &context() const;
 
-    static void setDamping(const double damping);
+    /*! Change the oscillators of the response spectrum without processing
+     * the motion again. The context must satisfy canResampleTo() of the
+     * current context. The scale factor is reset to 1.
+     */
+    virtual void setContext(const SpectralContextPtr &context) = 0;
 
-    static const QVector<double> &period();
+    double damping() const;
 
-    static void setPeriod(QVector<double> &period);
+    const QVector<double> &period() const;
 
     Flag flag() const;
 
@@ -69,6 +76,9 @@ public:
     //! Scale the properties of the motion by a factor
     virtual void scaleBy(const double factor);
 
+    //! Scale factor currently applied to the properties
+    double scale() const;
+
 protected:
     //! Event -- identified by the folder
     QString m_event;
@@ -78,11 +88,8 @@ protected:
 
     //! Response spectrum
     //@{
-    //! Damping of the response spectrum
-    static double m_damping;
-
-    //! Period of the response spectrum
-    static QVector<double> m_period;
+    //! Period and damping of the response spectrum
+    SpectralContextPtr m_context;
 
     //! Average spectral acceleration of all motions in group
     QVector<double> m_sa;
@@ -0,0 +1,428 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#include "BatchRunner.h"
+#include "ConditionalMeanSpectrum.h"
+#include "RecordReader.h"
+#include "SuiteWriter.h"
+
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QtDebug>
+
+#include <cstring>
+
+namespace {
+    //! Check if a flag is one of the command line arguments
+    bool hasFlag(int argc, char *argv[], const char *flag) {
+        for (int i = 1; i < argc; ++i) {
+            if (strcmp(argv[i], flag) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+BatchRunner::BatchRunner(QObject *parent)
+        : QObject(parent), m_outputType(MotionSuite::CSVOutput) {
+    m_motionLibrary = new MotionLibrary;
+
+    connect(m_motionLibrary, SIGNAL(logText(QString)), this, SLOT(printLog(QString)));
+    connect(m_motionLibrary, SIGNAL(percentChanged(int)), this, SLOT(printPercent(int)));
+}
+
+BatchRunner::~BatchRunner() {
+    delete m_motionLibrary;
+    qDeleteAll(m_targets);
+}
+
+bool BatchRunner::isRequested(int argc, char *argv[]) {
+    return hasFlag(argc, argv, "--batch");
+}
+
+bool BatchRunner::isTwoColumnRequested(int argc, char *argv[]) {
+    return hasFlag(argc, argv, "--two-column");
+}
+
+void BatchRunner::addOptions(QCommandLineParser &parser) const {
+    parser.setApplicationDescription(
+            tr("Select suites for a number of target spectra without the graphical interface."));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("targets", tr("Target spectra files."), "[targets...]");
+
+    parser.addOptions({
+            {"batch", tr("Run without the graphical interface.")},
+            {{"t", "target"}, tr("Target spectrum file. May be repeated."), tr("file")},
+            {{"o", "output"}, tr("Destination directory of the suites."), tr("directory"),
+             QDir::currentPath()},
+            {{"m", "motion-path"}, tr("Path of the motion library."), tr("path")},
+            {"suite-size", tr("Number of motions in a suite."), tr("count")},
+            {"seed-size", tr("Number of motions in the seed combination."), tr("count")},
+            {"suite-count", tr("Number of suites to save for each target."), tr("count")},
+            {"filter", tr("Screen the motions by intensity measures, "
+                          "e.g. \"d5-95 between 10 and 40, pgv > 20\"."), tr("expression")},
+            {"pack", tr("Pack the record files of the motion path into a single library file "
+                        "and exit."), tr("file")},
+            {"single-precision", tr("Store the acceleration of the packed library as float32.")},
+            {"two-column", tr("Also read *.txt and *.dat files of time and acceleration (g) in "
+                              "two columns.")},
+            {"benchmark", tr("Time the scan and the reading of the records in the motion path "
+                             "and exit.")},
+            {"pair-combination", tr("Spectrum of combined components: geomean, rotd50, or "
+                                    "rotd100."), tr("mode")},
+            {"cms-periods", tr("Treat the targets as uniform hazard spectra and select suites for "
+                               "the conditional mean spectra at these comma separated periods."),
+             tr("periods")},
+            {"cms-epsilon", tr("Epsilon of the uniform hazard spectra."), tr("epsilon"), "1.0"},
+            {"checkpoint", tr("Periodically save the state of the selection to the file."),
+             tr("file")},
+            {"checkpoint-interval", tr("Time between checkpoints in seconds."), tr("seconds"),
+             "300"},
+            {"resume", tr("Continue the selection from the checkpoint file.")},
+            {"time-series", tr("Also save the scaled acceleration of the motions in the suites, "
+                               "as AT2 files (at2) or a packed library (sslib)."), tr("format")},
+            {"format", tr("Format of the suites: csv for a file per suite or npz for a NumPy "
+                          "archive per target."), tr("format"), "csv"},
+            {"shard", tr("Only evaluate one shard of the seeds, e.g. \"3/16\". The result of "
+                         "the shard is saved to the checkpoint file."), tr("index/count")},
+            {"merge", tr("Merge the checkpoint files of all of the shards. May be repeated."),
+             tr("file")},
+    });
+}
+
+bool BatchRunner::applyOptions(const QCommandLineParser &parser) {
+    if (parser.isSet("motion-path")) {
+        if (QFile::exists(parser.value("motion-path")) == false) {
+            qCritical() << "Motion path does not exist:" << parser.value("motion-path");
+            return false;
+        }
+        m_motionLibrary->setMotionPath(parser.value("motion-path"));
+    }
+
+    if (parser.isSet("filter")) {
+        m_motionLibrary->setFilter(parser.value("filter"));
+    }
+
+    bool ok = true;
+    if (ok && parser.isSet("suite-size")) {
+        m_motionLibrary->setSuiteSize(parser.value("suite-size").toInt(&ok));
+    }
+    if (ok && parser.isSet("seed-size")) {
+        m_motionLibrary->setSeedSize(parser.value("seed-size").toInt(&ok));
+    }
+    if (ok && parser.isSet("suite-count")) {
+        m_motionLibrary->setSuiteCount(parser.value("suite-count").toInt(&ok));
+    }
+
+    if (ok == false) {
+        qCritical("Suite size, seed size, and suite count must be integers.");
+        return false;
+    }
+
+    if (parser.isSet("pair-combination")) {
+        const QStringList modes = {"geomean", "rotd50", "rotd100"};
+        const int mode = modes.indexOf(parser.value("pair-combination").toLower());
+        if (mode < 0) {
+            qCritical() << "Unknown pair combination:" << parser.value("pair-combination");
+            return false;
+        }
+        m_motionLibrary->setPairCombination(mode);
+    }
+
+    if (parser.value("format") == "csv") {
+        m_outputType = MotionSuite::CSVOutput;
+    } else if (parser.value("format") == "npz") {
+        m_outputType = MotionSuite::NumpyOutput;
+    } else {
+        qCritical() << "Unknown format:" << parser.value("format");
+        return false;
+    }
+
+    if (parser.isSet("time-series") && parser.value("time-series") != "at2"
+        && parser.value("time-series") != "sslib") {
+        qCritical() << "Unknown time series format:" << parser.value("time-series");
+        return false;
+    }
+    m_timeSeries = parser.value("time-series");
+
+    if (parser.isSet("resume") && parser.isSet("checkpoint") == false) {
+        qCritical("A checkpoint file is required to resume.");
+        return false;
+    }
+
+    const int interval = parser.value("checkpoint-interval").toInt(&ok);
+    if (ok == false || interval < 1) {
+        qCritical("The checkpoint interval must be a positive integer.");
+        return false;
+    }
+
+    m_motionLibrary->setCheckpoint(parser.value("checkpoint"), interval);
+    m_motionLibrary->setResume(parser.isSet("resume"));
+
+    if (parser.isSet("shard")) {
+        const QStringList parts = parser.value("shard").split('/');
+        bool indexOk = false;
+        bool countOk = false;
+        const int index = parts.first().toInt(&indexOk);
+        const int count = parts.last().toInt(&countOk);
+
+        if (parts.size() != 2 || !indexOk || !countOk || count < 1 || index < 1 || index > count) {
+            qCritical() << "Invalid shard:" << parser.value("shard");
+            return false;
+        }
+
+        if (parser.isSet("checkpoint") == false) {
+            qCritical("A checkpoint file is required to save the result of the shard.");
+            return false;
+        }
+
+        if (parser.isSet("merge")) {
+            qCritical("Shards cannot be selected and merged at the same time.");
+            return false;
+        }
+
+        m_motionLibrary->setShard(index - 1, count);
+    }
+
+    return true;
+}
+
+bool BatchRunner::loadTargets(const QStringList &fileNames) {
+    for (const QString &fileName : fileNames) {
+        TargetSpectrum *target = new TargetSpectrum(QFileInfo(fileName).completeBaseName());
+        m_targets << target;
+
+        if (target->load(fileName) == false) {
+            return false;
+        }
+    }
+
+    if (m_targets.isEmpty()) {
+        qCritical("No target specified");
+        return false;
+    }
+
+    return true;
+}
+
+bool BatchRunner::generateCms(const QCommandLineParser &parser, const QDir &destDir) {
+    bool ok;
+    const double epsilon = parser.value("cms-epsilon").toDouble(&ok);
+    if (ok == false) {
+        qCritical("CMS epsilon must be a number.");
+        return false;
+    }
+
+    QVector<double> condPeriods;
+    for (const QString &value : parser.value("cms-periods").split(',', QString::SkipEmptyParts)) {
+        condPeriods << value.toDouble(&ok);
+        if (ok == false || condPeriods.last() <= 0) {
+            qCritical() << "Invalid CMS conditioning period:" << value;
+            return false;
+        }
+    }
+
+    QList<TargetSpectrum *> targets;
+    for (const TargetSpectrum *uhs : m_targets) {
+        if (uhs->isValid() == false) {
+            qDeleteAll(targets);
+            return false;
+        }
+        targets << ConditionalMeanSpectrum(*uhs, epsilon).generate(condPeriods);
+    }
+
+    qDeleteAll(m_targets);
+    m_targets = targets;
+
+    // Save the generated targets next to the suites
+    for (const TargetSpectrum *target : m_targets) {
+        if (target->save(destDir.absoluteFilePath(target->name() + ".csv")) == false) {
+            return false;
+        }
+    }
+
+    printLog(QString("Generated %1 conditional mean spectra").arg(m_targets.size()));
+
+    return true;
+}
+
+int BatchRunner::exec(const QStringList &arguments) {
+    QCommandLineParser parser;
+    addOptions(parser);
+    parser.process(arguments);
+
+    if (applyOptions(parser) == false) {
+        return 1;
+    }
+
+    if (parser.isSet("benchmark")) {
+        return benchmark(m_motionLibrary->motionPath()) ? 0 : 1;
+    }
+
+    if (parser.isSet("pack")) {
+        return m_motionLibrary->pack(parser.value("pack"), parser.isSet("single-precision")) ? 0 : 1;
+    }
+
+    if (loadTargets(parser.values("target") + parser.positionalArguments()) == false) {
+        return 1;
+    }
+
+    QDir destDir(parser.value("output"));
+    if (destDir.exists() == false && destDir.mkpath(".") == false) {
+        qCritical() << "Unable to create directory:" << destDir.absolutePath();
+        return 1;
+    }
+
+    if (parser.isSet("cms-periods") && generateCms(parser, destDir) == false) {
+        return 1;
+    }
+
+    QVector<QList<MotionSuite *>> suites;
+    bool success = m_motionLibrary->computeBatch(m_targets, suites, parser.values("merge"));
+
+    // The suites of a shard are saved in the checkpoint and written once merged
+    const bool isShard = parser.isSet("shard");
+    if (success && isShard) {
+        printLog("Saved the shard to " + parser.value("checkpoint"));
+    }
+
+    for (int i = 0; success && !isShard && i < suites.size(); ++i) {
+        success = writeSuites(m_targets.at(i), suites.at(i), destDir);
+    }
+
+    // The suites refer to the targets and need to be deleted first
+    for (QList<MotionSuite *> &list : suites) {
+        qDeleteAll(list);
+    }
+
+    return success ? 0 : 1;
+}
+
+bool BatchRunner::writeSuites(const TargetSpectrum *target, const QList<MotionSuite *> &suites,
+                              const QDir &destDir) {
+    if (m_outputType == MotionSuite::NumpyOutput && suites.isEmpty() == false) {
+        const QString fileName = destDir.absoluteFilePath(target->name() + ".npz");
+        if (SuiteWriter::writeNumpy(fileName, suites) == false) {
+            return false;
+        }
+
+        printLog(QString("Saved %1 suites for %2").arg(suites.size()).arg(target->name()));
+        return writeTimeSeries(target, suites, destDir);
+    }
+
+    QStringList fileNames;
+    for (int i = 0; i < suites.size(); ++i) {
+        fileNames << destDir.absoluteFilePath(QString("%1-%2.csv").arg(target->name()).arg(i + 1));
+    }
+
+    if (SuiteWriter::write(suites, fileNames, MotionSuite::CSVOutput) == false) {
+        return false;
+    }
+
+    printLog(QString("Saved %1 suites for %2").arg(suites.size()).arg(target->name()));
+
+    return writeTimeSeries(target, suites, destDir);
+}
+
+bool BatchRunner::writeTimeSeries(const TargetSpectrum *target, const QList<MotionSuite *> &suites,
+                                  const QDir &destDir) {
+    if (m_timeSeries.isEmpty() || suites.isEmpty()) {
+        return true;
+    }
+
+    QStringList suiteNames;
+    for (int i = 0; i < suites.size(); ++i) {
+        suiteNames << QString("%1-%2").arg(target->name()).arg(i + 1);
+    }
+
+    const QString dirName = destDir.absoluteFilePath(target->name() + "-motions");
+    if (SuiteWriter::writeTimeSeries(suites, suiteNames, dirName, m_timeSeries == "sslib") == false) {
+        return false;
+    }
+
+    printLog("Saved the scaled time series to " + dirName);
+
+    return true;
+}
+
+bool BatchRunner::benchmark(const QString &path) {
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList fileNames;
+    qint64 size = 0;
+    QDirIterator it(path, RecordReader::allNameFilters(), QDir::Files | QDir::Readable,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString fileName = it.next();
+        if (Motion::isVertical(fileName) == false) {
+            fileNames << fileName;
+            size += it.fileInfo().size();
+        }
+    }
+    const double scanTime = timer.nsecsElapsed() * 1e-6;
+
+    if (fileNames.isEmpty()) {
+        qCritical() << "No records found in:" << path;
+        return false;
+    }
+
+    int passes = 0;
+    int failed = 0;
+    qint64 values = 0;
+    timer.restart();
+    do {
+        for (const QString &fileName : fileNames) {
+            RecordReader::Record record;
+            if (RecordReader::readFile(fileName, record)) {
+                values += record.acc.size();
+            } else if (passes == 0) {
+                ++failed;
+            }
+        }
+        ++passes;
+    } while (timer.elapsed() < 1000);
+    const double readTime = timer.nsecsElapsed() * 1e-6 / passes;
+
+    printLog(QString("Scanned %1 records in %2 ms").arg(fileNames.size()).arg(scanTime, 0, 'f', 2));
+    printLog(QString("Read %1 records (%2 failed) in %3 ms per pass over %4 passes")
+                     .arg(fileNames.size())
+                     .arg(failed)
+                     .arg(readTime, 0, 'f', 2)
+                     .arg(passes));
+    printLog(QString("  %1 us per record, %2 MB/s, %3 million values/s")
+                     .arg(1e3 * readTime / fileNames.size(), 0, 'f', 1)
+                     .arg(size / (1e3 * readTime), 0, 'f', 1)
+                     .arg(values / passes / (1e3 * readTime), 0, 'f', 2));
+
+    return failed == 0;
+}
+
+void BatchRunner::printLog(const QString &text) {
+    qInfo().noquote() << text;
+}
+
+void BatchRunner::printPercent(int percent) {
+    if (percent % 10 == 0) {
+        qInfo().noquote() << QString("%1%").arg(percent);
+    }
+}
@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef BATCH_RUNNER_H_
+#define BATCH_RUNNER_H_
+
+#include "MotionLibrary.h"
+#include "TargetSpectrum.h"
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+
+/*! BatchRunner selects suites without the graphical interface.
+ *
+ * The motion library is loaded once and the suites are selected for each of
+ * the target spectra provided on the command line. The settings that are not
+ * provided on the command line are taken from the last session of the
+ * graphical interface.
+ */
+class BatchRunner : public QObject {
+Q_OBJECT
+
+public:
+    BatchRunner(QObject *parent = 0);
+
+    ~BatchRunner();
+
+    //! Check if the command line arguments request a batch run
+    static bool isRequested(int argc, char *argv[]);
+
+    /*! Check if the command line arguments request the two column reader,
+     * which is registered before the motion library is created.
+     */
+    static bool isTwoColumnRequested(int argc, char *argv[]);
+
+    /*! Run the batch.
+     * \param arguments command line arguments
+     * \return exit code of the application
+     */
+    int exec(const QStringList &arguments);
+
+private slots:
+
+    void printLog(const QString &text);
+
+    void printPercent(int percent);
+
+private:
+    //! Add the options to the parser
+    void addOptions(QCommandLineParser &parser) const;
+
+    //! Apply the library settings provided on the command line
+    bool applyOptions(const QCommandLineParser &parser);
+
+    //! Load the targets from the files
+    bool loadTargets(const QStringList &fileNames);
+
+    /*! Replace each of the targets with the conditional mean spectra
+     * conditioned on the periods provided on the command line. The targets
+     * are then treated as uniform hazard spectra.
+     */
+    bool generateCms(const QCommandLineParser &parser, const QDir &destDir);
+
+    /*! Write the suites selected for a target.
+     * \param target target spectrum
+     * \param suites suites selected for the target
+     * \param destDir destination directory
+     */
+    bool writeSuites(const TargetSpectrum *target, const QList<MotionSuite *> &suites, const QDir &destDir);
+
+    //! Write the scaled time series of the suites selected for a target
+    bool writeTimeSeries(const TargetSpectrum *target, const QList<MotionSuite *> &suites,
+                         const QDir &destDir);
+
+    /*! Time the scan and the reading of the records in a path. The records
+     * are read repeatedly for at least a second, so that the files are cached
+     * and the parsing is timed rather than the disk.
+     */
+    bool benchmark(const QString &path);
+
+    MotionLibrary *m_motionLibrary;
+
+    QList<TargetSpectrum *> m_targets;
+
+    //! Format of the suites
+    MotionSuite::OutputType m_outputType;
+
+    //! Format of the scaled time series, none if empty
+    QString m_timeSeries;
+};
+
+#endif
@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "ConditionalMeanSpectrum.h"
+
+#include <QtGlobal>
+
+ConditionalMeanSpectrum::ConditionalMeanSpectrum(const TargetSpectrum &uhs, double epsilon)
+        : m_name(uhs.name()), m_period(uhs.inputPeriod()), m_lnStd(uhs.inputLnStd()) {
+    m_lnUhs.resize(m_period.size());
+    m_epsLnStd.resize(m_period.size());
+
+    for (int i = 0; i < m_period.size(); ++i) {
+        m_lnUhs[i] = log(uhs.inputSa().at(i));
+        m_epsLnStd[i] = epsilon * m_lnStd.at(i);
+    }
+}
+
+double ConditionalMeanSpectrum::correlation(double periodA, double periodB) {
+    const double minPeriod = qMin(periodA, periodB);
+    const double maxPeriod = qMax(periodA, periodB);
+
+    const double c1 = 1 - cos(M_PI / 2 - 0.366 * log(maxPeriod / qMax(minPeriod, 0.109)));
+
+    double c2 = 0;
+    if (maxPeriod < 0.2) {
+        c2 = 1 - 0.105 * (1 - 1 / (1 + exp(100 * maxPeriod - 5)))
+                 * (maxPeriod - minPeriod) / (maxPeriod - 0.0099);
+    }
+
+    const double c3 = (maxPeriod < 0.109) ? c2 : c1;
+    const double c4 = c1 + 0.5 * (sqrt(c3) - c3) * (1 + cos(M_PI * minPeriod / 0.109));
+
+    if (maxPeriod < 0.109) {
+        return c2;
+    } else if (minPeriod > 0.109) {
+        return c1;
+    } else if (maxPeriod < 0.2) {
+        return qMin(c2, c4);
+    } else {
+        return c4;
+    }
+}
+
+void ConditionalMeanSpectrum::generate(double condPeriod, TargetSpectrum &target) const {
+    const int n = m_period.size();
+
+    target.inputPeriod() = m_period;
+    target.inputSa().resize(n);
+    target.inputLnStd().resize(n);
+
+    double *sa = target.inputSa().data();
+    double *lnStd = target.inputLnStd().data();
+
+    for (int i = 0; i < n; ++i) {
+        const double rho = correlation(m_period.at(i), condPeriod);
+        sa[i] = exp(m_lnUhs.at(i) - (1 - rho) * m_epsLnStd.at(i));
+        lnStd[i] = m_lnStd.at(i) * sqrt(qMax(0., 1 - rho * rho));
+    }
+}
+
+QList<TargetSpectrum *> ConditionalMeanSpectrum::generate(const QVector<double> &condPeriods) const {
+    QList<TargetSpectrum *> targets;
+
+    for (double condPeriod : condPeriods) {
+        TargetSpectrum *target = new TargetSpectrum(
+                QString("%1-cms-%2s").arg(m_name).arg(condPeriod));
+        generate(condPeriod, *target);
+        targets << target;
+    }
+
+    return targets;
+}
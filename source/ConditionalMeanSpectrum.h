@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CONDITIONAL_MEAN_SPECTRUM_H_
+#define CONDITIONAL_MEAN_SPECTRUM_H_
+
+#include "TargetSpectrum.h"
+
+#include <QList>
+#include <QVector>
+
+/*! ConditionalMeanSpectrum generates conditional mean spectrum (CMS) targets
+ * from a uniform hazard spectrum (UHS).
+ *
+ * The UHS is assumed to be exceeded by the same number of standard deviations
+ * (epsilon) at all periods.  The CMS conditioned on the spectral acceleration
+ * at a period T* is then:
+ *
+ *   ln CMS(T) = ln UHS(T) - (1 - rho(T, T*)) * epsilon * sigma(T)
+ *   sigma_CMS(T) = sigma(T) * sqrt(1 - rho(T, T*)^2)
+ *
+ * where rho is the correlation of the spectral accelerations computed with the
+ * model of Baker and Jayaram (2008).
+ */
+class ConditionalMeanSpectrum {
+public:
+    /*!
+     * \param uhs uniform hazard spectrum defined by the input of the target
+     * \param epsilon number of standard deviations of the UHS above the median
+     */
+    ConditionalMeanSpectrum(const TargetSpectrum &uhs, double epsilon);
+
+    /*! Correlation of the spectral accelerations at two periods.
+     * Baker and Jayaram (2008) model, valid for periods between 0.01 and 10 s.
+     */
+    static double correlation(double periodA, double periodB);
+
+    /*! Generate the CMS conditioned at a single period.
+     * \param condPeriod conditioning period (s)
+     * \param target target whose input is replaced by the CMS
+     */
+    void generate(double condPeriod, TargetSpectrum &target) const;
+
+    /*! Generate the CMS for each of the conditioning periods.
+     * The per-period terms are computed once and shared by all of the
+     * conditioning periods.
+     * \param condPeriods conditioning periods (s)
+     * \return targets owned by the caller, named by the conditioning period
+     */
+    QList<TargetSpectrum *> generate(const QVector<double> &condPeriods) const;
+
+private:
+    //! Name of the UHS
+    QString m_name;
+
+    //! Periods of the UHS
+    QVector<double> m_period;
+
+    //! Natural log of the UHS
+    QVector<double> m_lnUhs;
+
+    //! Logarithmic standard deviation of the UHS
+    QVector<double> m_lnStd;
+
+    //! Reduction of the UHS if uncorrelated -- epsilon * sigma
+    QVector<double> m_epsLnStd;
+};
+
+#endif
@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#include "DirectoryScanner.h"
+#include "Motion.h"
+#include "PackedLibrary.h"
+#include "RecordReader.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QThreadPool>
+
+namespace {
+    //! Delay after the last request before scanning (msec)
+    const int DebounceDelay = 400;
+
+    //! Largest number of directories that are watched, only the root of
+    //! larger trees is watched to stay within the limits of the system
+    const int MaxWatchedDirs = 256;
+}
+
+DirectoryScanner::DirectoryScanner(QObject *parent)
+        : QObject(parent), m_cachedCount(0) {
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(DebounceDelay);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(startScan()));
+
+    connect(&m_watcher, SIGNAL(directoryChanged(QString)), this, SLOT(invalidate(QString)));
+    connect(&m_watcher, SIGNAL(fileChanged(QString)), this, SLOT(invalidate(QString)));
+}
+
+DirectoryScanner::~DirectoryScanner() {
+    cancel();
+}
+
+int DirectoryScanner::countPath(const QString &path, const QAtomicInt *cancel, QStringList *dirs,
+                                QString *error) {
+    if (PackedLibrary::isPacked(path)) {
+        // Only the header and metadata are read
+        PackedLibrary library;
+        if (library.open(path) == false) {
+            if (error) {
+                *error = library.errorString();
+            }
+            return 0;
+        }
+
+        // Vertical components are packed, but are not counted as motions
+        int count = 0;
+        for (int i = 0; i < library.count(); ++i) {
+            if (!Motion::isVertical(library.record(i).fileName)) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    int count = 0;
+
+    if (dirs) {
+        *dirs << path;
+    }
+
+    QDirIterator it(path, RecordReader::allNameFilters(),
+            QDir::AllDirs | QDir::Files | QDir::Readable | QDir::NoDotAndDotDot,
+            QDirIterator::Subdirectories);
+
+    while (it.hasNext()) {
+        if (cancel && cancel->load()) {
+            break;
+        }
+
+        const QString filePath = it.next();
+        if (it.fileInfo().isDir()) {
+            if (dirs) {
+                *dirs << filePath;
+            }
+        } else if (!Motion::isVertical(filePath)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+int DirectoryScanner::count(const QString &path) {
+    if (!m_cachedKey.isEmpty() && cacheKey(path) == m_cachedKey) {
+        return m_cachedCount;
+    }
+
+    QStringList dirs;
+    const int n = countPath(path, 0, &dirs);
+    store(path, n, dirs);
+    return n;
+}
+
+void DirectoryScanner::request(const QString &path) {
+    m_path = path;
+
+    // The cached count is returned immediately
+    if (!m_cachedKey.isEmpty() && cacheKey(path) == m_cachedKey) {
+        m_timer.stop();
+        emit countChanged(path, m_cachedCount);
+        return;
+    }
+
+    m_timer.start();
+}
+
+void DirectoryScanner::cancel() {
+    m_timer.stop();
+    if (m_cancel) {
+        m_cancel->store(1);
+        m_cancel.clear();
+    }
+}
+
+void DirectoryScanner::rescan() {
+    clearCache();
+    if (!m_path.isEmpty()) {
+        request(m_path);
+    }
+}
+
+void DirectoryScanner::startScan() {
+    // Stop the previous scan
+    if (m_cancel) {
+        m_cancel->store(1);
+    }
+    m_cancel = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+
+    ScanJob *job = new ScanJob(m_path, m_cancel);
+    connect(job, SIGNAL(finished(QString, int, QStringList, QString, bool)), this,
+            SLOT(finishScan(QString, int, QStringList, QString, bool)));
+    QThreadPool::globalInstance()->start(job);
+}
+
+void DirectoryScanner::finishScan(const QString &path, int count, const QStringList &dirs,
+                                  const QString &error, bool cancelled) {
+    if (cancelled) {
+        return;
+    }
+
+    // A path that could not be read is not cached, so that it is scanned
+    // again once it is complete
+    if (error.isEmpty()) {
+        store(path, count, dirs);
+    }
+
+    if (path == m_path) {
+        m_cancel.clear();
+        if (error.isEmpty() == false) {
+            emit scanFailed(path, error);
+        }
+        emit countChanged(path, count);
+    }
+}
+
+void DirectoryScanner::invalidate(const QString &changedPath) {
+    const QString changed = cacheKey(changedPath);
+
+    if (!m_cachedKey.isEmpty()
+        && (changed == m_cachedKey || changed.startsWith(m_cachedKey + "/"))) {
+        clearCache();
+    }
+
+    if (cacheKey(m_path) == changed || changed.startsWith(cacheKey(m_path) + "/")) {
+        request(m_path);
+    }
+}
+
+QString DirectoryScanner::cacheKey(const QString &path) {
+    const QString canonical = QFileInfo(path).canonicalFilePath();
+    return canonical.isEmpty() ? QDir::cleanPath(path) : canonical;
+}
+
+void DirectoryScanner::store(const QString &path, int count, const QStringList &dirs) {
+    const QString key = cacheKey(path);
+    if (key != cacheKey(m_path)) {
+        return;
+    }
+
+    clearCache();
+    m_cachedKey = key;
+    m_cachedCount = count;
+
+    if (PackedLibrary::isPacked(path) || dirs.size() > MaxWatchedDirs) {
+        m_watcher.addPath(path);
+    } else if (dirs.isEmpty() == false) {
+        m_watcher.addPaths(dirs);
+    }
+}
+
+void DirectoryScanner::clearCache() {
+    m_cachedKey.clear();
+    m_cachedCount = 0;
+
+    const QStringList watched = m_watcher.files() + m_watcher.directories();
+    if (watched.isEmpty() == false) {
+        m_watcher.removePaths(watched);
+    }
+}
+
+ScanJob::ScanJob(const QString &path, const QSharedPointer<QAtomicInt> &cancel)
+        : m_path(path), m_cancel(cancel) {
+    // Deleted on the thread of the scanner once the result is delivered
+    setAutoDelete(false);
+}
+
+void ScanJob::run() {
+    QStringList dirs;
+    QString error;
+    const int count = DirectoryScanner::countPath(m_path, m_cancel.data(), &dirs, &error);
+
+    // Errors are delivered to the thread of the scanner to be reported
+    emit finished(m_path, count, dirs, error, m_cancel->load() != 0);
+    deleteLater();
+}
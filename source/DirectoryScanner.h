@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DIRECTORY_SCANNER_H_
+#define DIRECTORY_SCANNER_H_
+
+#include <QAtomicInt>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+/*! DirectoryScanner counts the motions found in a motion path.
+ *
+ * Requests are debounced, so that typing a path only scans the final path.
+ * The scan runs on the global thread pool and is cancelled when another path
+ * is requested. The count of the requested path is cached and its directories
+ * are watched, so that the cached count is discarded when the library
+ * changes. The watches of a previous path are released when another path is
+ * requested, and only the root of a large directory tree is watched. Watches
+ * may not fire on network file systems, where rescan() discards the count.
+ */
+class DirectoryScanner : public QObject {
+Q_OBJECT
+
+public:
+    DirectoryScanner(QObject *parent = 0);
+
+    ~DirectoryScanner();
+
+    /*! Count the motions in the path on the calling thread. Errors are not
+     * reported, as the scan may run on a worker thread.
+     * \param path directory of record files or a packed library
+     * \param cancel scan stops if set, may be null
+     * \param dirs directories that were scanned, may be null
+     * \param error description of the error if the path could not be read, may be null
+     * \return number of motions
+     */
+    static int countPath(const QString &path, const QAtomicInt *cancel = 0, QStringList *dirs = 0,
+                         QString *error = 0);
+
+    /*! Count of the path, from the cache if available or by scanning on the
+     * calling thread otherwise.
+     */
+    int count(const QString &path);
+
+public slots:
+
+    //! Request an asynchronous count of the path
+    void request(const QString &path);
+
+    //! Cancel the pending request and running scan
+    void cancel();
+
+    //! Discard the cached count and scan the requested path again
+    void rescan();
+
+signals:
+
+    //! Count of the path is available
+    void countChanged(const QString &path, int count);
+
+    //! The requested path could not be read, emitted before countChanged()
+    void scanFailed(const QString &path, const QString &error);
+
+private slots:
+
+    //! Start the scan of the requested path
+    void startScan();
+
+    //! Store the result of a scan
+    void finishScan(const QString &path, int count, const QStringList &dirs,
+                    const QString &error, bool cancelled);
+
+    //! Discard the cached count if it is affected by a change
+    void invalidate(const QString &changedPath);
+
+private:
+    //! Key of the path in the cache
+    static QString cacheKey(const QString &path);
+
+    /*! Store the count of the requested path and watch the scanned paths in
+     * place of the paths of the previous count. Counts of other paths are
+     * not stored.
+     */
+    void store(const QString &path, int count, const QStringList &dirs);
+
+    //! Discard the cached count and release the watches
+    void clearCache();
+
+    //! Delay between the last request and the scan
+    QTimer m_timer;
+
+    //! Path requested
+    QString m_path;
+
+    //! Cancellation flag of the running scan
+    QSharedPointer<QAtomicInt> m_cancel;
+
+    //! Key of the cached path -- empty if there is no cached count
+    QString m_cachedKey;
+
+    //! Count of the cached path
+    int m_cachedCount;
+
+    QFileSystemWatcher m_watcher;
+};
+
+/*! ScanJob counts the motions of a path on a worker thread.
+ * Used by DirectoryScanner.
+ */
+class ScanJob : public QObject, public QRunnable {
+Q_OBJECT
+
+public:
+    ScanJob(const QString &path, const QSharedPointer<QAtomicInt> &cancel);
+
+    void run();
+
+signals:
+
+    void finished(const QString &path, int count, const QStringList &dirs,
+                  const QString &error, bool cancelled);
+
+private:
+    QString m_path;
+
+    QSharedPointer<QAtomicInt> m_cancel;
+};
+
+#endif
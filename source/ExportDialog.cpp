@@ -17,6 +17,7 @@
 ////////////////////////////////////////////////////////////////////////////////////
 
 #include "ExportDialog.h"
+#include "SuiteWriter.h"
 
 #include <QCompleter>
 #include <QDialogButtonBox>
@@ -55,6 +56,10 @@ ExportDialog::ExportDialog(const QList<MotionSuite *> &suites, const QString &mo
     layout->addWidget(m_shake2kRadioButton, 5, 0, 1, 2);
     layout->addWidget(new QLabel(tr("-- suitable for use with SHAKE2000")), 6, 1);
 
+    m_numpyRadioButton = new QRadioButton(tr("NumPy archive (NPZ)"));
+    layout->addWidget(m_numpyRadioButton, 7, 0, 1, 2);
+    layout->addWidget(new QLabel(tr("-- all suites in one binary file for use with Python")), 8, 1);
+
     // Load initial file type
     switch (settings.value("exportDialog/outputType", MotionSuite::CSVOutput).toInt()) {
         case MotionSuite::NoOutput:
@@ -66,6 +71,9 @@ ExportDialog::ExportDialog(const QList<MotionSuite *> &suites, const QString &mo
         case MotionSuite::SHAKE2000Output:
             m_shake2kRadioButton->setChecked(true);
             break;
+        case MotionSuite::NumpyOutput:
+            m_numpyRadioButton->setChecked(true);
+            break;
         case MotionSuite::CSVOutput:
         default:
             m_csvRadioButton->setChecked(true);
@@ -106,11 +114,17 @@ ExportDialog::ExportDialog(const QList<MotionSuite *> &suites, const QString &mo
 
     layout->addWidget(m_summaryCheckBox, 3, 0, 1, 2);
 
+    // Scaled time series
+    m_timeSeriesCheckBox = new QCheckBox(tr("Include the scaled time series (AT2) of the enabled suites"));
+    m_timeSeriesCheckBox->setChecked(settings.value("exportDialog/timeSeries", false).toBool());
+
+    layout->addWidget(m_timeSeriesCheckBox, 4, 0, 1, 2);
+
     // Dialog buttons
     QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
     connect(buttonBox, SIGNAL(accepted()), SLOT(tryAccept()));
     connect(buttonBox, SIGNAL(rejected()), SLOT(reject()));
-    layout->addWidget(buttonBox, 4, 0, 1, 2);
+    layout->addWidget(buttonBox, 5, 0, 1, 2);
 
     setLayout(layout);
 }
@@ -147,12 +161,15 @@ void ExportDialog::tryAccept() {
         type = MotionSuite::StrataOutput;
     } else if (m_shake2kRadioButton->isChecked()) {
         type = MotionSuite::SHAKE2000Output;
+    } else if (m_numpyRadioButton->isChecked()) {
+        type = MotionSuite::NumpyOutput;
     }
 
     // Save old values in the settings
     QSettings settings;
     settings.setValue("exportDialog/outputType", int(type));
     settings.setValue("exportDialog/summary", m_summaryCheckBox->isChecked());
+    settings.setValue("exportDialog/timeSeries", m_timeSeriesCheckBox->isChecked());
     settings.setValue("exportDialog/destination", m_destinationLineEdit->text());
     settings.setValue("exportDialog/prefix", m_prefixLineEdit->text());
 
@@ -177,86 +194,90 @@ void ExportDialog::tryAccept() {
 
     QString baseName = m_destinationLineEdit->text() + QDir::separator() + m_prefixLineEdit->text();
 
+    bool written = true;
+
     switch (type) {
         case MotionSuite::NoOutput:
         case MotionSuite::SummaryOutput:
             // Do nothing
             break;
         case MotionSuite::CSVOutput:
+        case MotionSuite::StrataOutput: {
+            // Each of the suites is written to its own file
+            QList<MotionSuite *> suites;
+            QStringList fileNames;
             for (int i = 0; i < m_suites.size(); ++i) {
-                if (m_suites.at(i)->enabled() == false) {
-                    continue;
+                if (m_suites.at(i)->enabled()) {
+                    suites << m_suites.at(i);
+                    fileNames << QString("%1-%2.csv").arg(baseName).arg(i + 1);
                 }
-
-                QFile file(QString("%1-%2.csv").arg(baseName).arg(i + 1));
-
-                if (file.open(QIODevice::WriteOnly | QIODevice::Text) == false) { 
-                    qCritical() << "Unable to open file:" << file.fileName();
-                }
-
-                QTextStream out(&file);
-                m_suites.at(i)->toText(out, MotionSuite::CSVOutput);
             }
-            break;
-        case MotionSuite::StrataOutput:
-            for (int i = 0; i < m_suites.size(); ++i) {
-                if (m_suites.at(i)->enabled() == false) {
-                    continue;
-                }
-
-                QFile file(QString("%1-%2.csv").arg(baseName).arg(i + 1));
 
-                if (file.open(QIODevice::WriteOnly | QIODevice::Text) == false) {
-                    qCritical() << "Unable to open file:" << file.fileName();
-                }
-
-                QTextStream out(&file);
-                m_suites.at(i)->toText(out, MotionSuite::StrataOutput);
-            }
+            written = SuiteWriter::write(suites, fileNames, type);
             break;
+        }
         case MotionSuite::SHAKE2000Output: {
-            QFile file(QDir::currentPath() + QDir::separator() + "SuiteLog.txt");
-
-            if (file.open(QIODevice::WriteOnly | QIODevice::Text) == false) {
-                qCritical() << "Unable to open file:" << file.fileName();
-            }
-
-            QTextStream out(&file);
-
-            out << m_motionPath << endl
-                << endl;
+            QByteArray data = m_motionPath.toUtf8() + "\n\n";
 
             for (int i = 0; i < m_suites.size(); ++i) {
                 if (m_suites.at(i)->enabled() == false) {
                     continue;
                 }
 
-                out << QString("[ %1 of %2 ]\n").arg(i + 1).arg(m_suites.size());
-                m_suites.at(i)->toText(out, MotionSuite::SHAKE2000Output);
-                out << endl;
+                data += QString("[ %1 of %2 ]\n").arg(i + 1).arg(m_suites.size()).toUtf8();
+                data += SuiteWriter::format(m_suites.at(i), MotionSuite::SHAKE2000Output);
+                data += '\n';
             }
 
+            written = SuiteWriter::write(QDir::currentPath() + QDir::separator() + "SuiteLog.txt", data);
+            break;
+        }
+        case MotionSuite::NumpyOutput: {
+            // All of the suites are written to one file
+            QList<MotionSuite *> suites;
+            for (MotionSuite *suite : m_suites) {
+                if (suite->enabled()) {
+                    suites << suite;
+                }
+            }
+
+            written = SuiteWriter::writeNumpy(baseName + ".npz", suites);
             break;
         }
     }
 
+    if (written == false) {
+        return;
+    }
+
     if (m_summaryCheckBox->isChecked()) {
         QString destinationDir = (type == MotionSuite::SHAKE2000Output) ? QDir::currentPath()
                                                                         : m_destinationLineEdit->text();
 
-        QFile file(destinationDir + QDir::separator() + "summary.csv");
-
-        if (file.open(QIODevice::WriteOnly | QIODevice::Text) == false) {
-            qCritical() << "Unable to open file:" << file.fileName();
+        QByteArray data;
+        for (int i = 0; i < m_suites.size(); ++i) {
+            data += QString("[ %1 of %2 ]\n").arg(i + 1).arg(m_suites.size()).toUtf8();
+            data += SuiteWriter::format(m_suites.at(i), MotionSuite::SummaryOutput);
+            data += "\n\n";
         }
 
-        QTextStream out(&file);
+        if (SuiteWriter::write(destinationDir + QDir::separator() + "summary.csv", data) == false) {
+            return;
+        }
+    }
 
+    if (m_timeSeriesCheckBox->isChecked()) {
+        QList<MotionSuite *> suites;
+        QStringList suiteNames;
         for (int i = 0; i < m_suites.size(); ++i) {
-            out << QString("[ %1 of %2 ]\n").arg(i + 1).arg(m_suites.size());
-            m_suites.at(i)->toText(out, MotionSuite::SummaryOutput);
-            out << endl
-                << endl;
+            if (m_suites.at(i)->enabled()) {
+                suites << m_suites.at(i);
+                suiteNames << QString("%1-%2").arg(m_prefixLineEdit->text()).arg(i + 1);
+            }
+        }
+
+        if (SuiteWriter::writeTimeSeries(suites, suiteNames, baseName + "-motions") == false) {
+            return;
         }
     }
 
@@ -44,8 +44,10 @@ private:
     QRadioButton *m_csvRadioButton;
     QRadioButton *m_strataRadioButton;
     QRadioButton *m_shake2kRadioButton;
+    QRadioButton *m_numpyRadioButton;
 
     QCheckBox *m_summaryCheckBox;
+    QCheckBox *m_timeSeriesCheckBox;
 
     QLineEdit *m_destinationLineEdit;
 
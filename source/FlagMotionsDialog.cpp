@@ -21,6 +21,7 @@
 #include <QApplication>
 #include <QGridLayout>
 #include <QPushButton>
+#include <QSet>
 #include <QSplitter>
 #include <QTableView>
 
@@ -33,6 +34,7 @@
 #include "MotionPair.h"
 #include "StringListDelegate.h"
 #include "SuiteDialog.h"
+#include "TimeSeriesCurve.h"
 
 FlagMotionsModel::FlagMotionsModel(QList<AbstractMotion *> &motions, QObject *parent)
         : QAbstractTableModel(parent), m_motions(motions) {
@@ -201,9 +203,8 @@ FlagMotionsDialog::FlagMotionsDialog(QList<AbstractMotion *> &motions, QWidget *
 
         tsLayout->addWidget(plot);
         for (int j = 0; j < colors.size(); ++j) {
-            QwtPlotCurve *curve = new QwtPlotCurve;
+            TimeSeriesCurve *curve = new TimeSeriesCurve;
             curve->setPen(QPen(colors.at(j)));
-            curve->setRenderHint(QwtPlotItem::RenderAntialiased);
             curve->attach(plot);
             // One set of colors and then the next set of three
             m_curves[i + yLabels.size() * j] = curve;
@@ -237,21 +238,35 @@ FlagMotionsDialog::FlagMotionsDialog(QList<AbstractMotion *> &motions, QWidget *
 void FlagMotionsDialog::selectMotion(const QModelIndex &current, const QModelIndex &previous) {
     Q_UNUSED(previous);
     AbstractMotion *absMotion = m_motions.at(current.row());
+
+    // Replot each plot once after all of its curves are updated
+    QSet<QwtPlot *> plots;
+    for (TimeSeriesCurve *curve : m_curves) {
+        plots << curve->plot();
+    }
+    for (QwtPlot *plot : plots) {
+        plot->setAutoReplot(false);
+    }
+
     int i = 0;
     if (m_groupedMotions) {
         MotionPair *mp = dynamic_cast<MotionPair *>(absMotion);
         for (const Motion *m : {mp->motionA(), mp->motionB()}) {
-            for (const QVector<double> &values : {m->acc(), m->vel(), m->disp()}) {
-                qDebug() << i << m_curves[i];
-                m_curves[i]->setSamples(m->time(), values);
+            for (const TimeSeries *values : {&m->acc(), &m->vel(), &m->disp()}) {
+                m_curves[i]->setSeries(m->time(), *values);
                 ++i;
             }
         }
     } else {
         Motion *m = dynamic_cast<Motion *>(absMotion);
-        for (const QVector<double> &values : {m->acc(), m->vel(), m->disp()}) {
-            m_curves[i]->setSamples(m->time(), values);
+        for (const TimeSeries *values : {&m->acc(), &m->vel(), &m->disp()}) {
+            m_curves[i]->setSeries(m->time(), *values);
             ++i;
         }
     }
+
+    for (QwtPlot *plot : plots) {
+        plot->setAutoReplot(true);
+        plot->replot();
+    }
 }
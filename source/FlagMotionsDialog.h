@@ -23,9 +23,8 @@
 #include <QDialog>
 #include <QList>
 
-#include <qwt_plot_curve.h>
-
 #include "AbstractMotion.h"
+#include "TimeSeriesCurve.h"
 
 class FlagMotionsModel : public QAbstractTableModel {
 Q_OBJECT
@@ -67,7 +66,7 @@ protected:
     bool m_groupedMotions;
 
     //! Curves for each of the plots
-    QVector<QwtPlotCurve *> m_curves;
+    QVector<TimeSeriesCurve *> m_curves;
 };
 
 #endif // FLAGMOTIONSDIALOG_H
@@ -140,3 +140,13 @@ bool InputTableModel::removeRows(int row, int count, const QModelIndex &parent)
 
     return true;
 }
+
+void InputTableModel::setInput(const TargetSpectrum &target) {
+    beginResetModel();
+
+    m_motionLibrary->inputPeriod() = target.inputPeriod();
+    m_motionLibrary->inputSa() = target.inputSa();
+    m_motionLibrary->inputLnStd() = target.inputLnStd();
+
+    endResetModel();
+}
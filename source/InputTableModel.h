@@ -47,6 +47,9 @@ public:
 
     bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex());
 
+    //! Replace the input with that of the target, such as a generated CMS
+    void setInput(const TargetSpectrum &target);
+
 private:
     enum Columns {
         PERIOD_COLUMN,
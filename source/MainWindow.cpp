@@ -20,6 +20,7 @@
 ////////////////////////////////////////////////////////////////////////////////////
 
 #include "MainWindow.h"
+#include "ConditionalMeanSpectrum.h"
 #include "FlagMotionsDialog.h"
 #include "InputTableModel.h"
 #include "SuiteDialog.h"
@@ -28,6 +29,7 @@
 #include <QClipboard>
 #include <QDesktopServices>
 #include <QFormLayout>
+#include <QInputDialog>
 #include <QLabel>
 #include <QMenuBar>
 #include <QMessageBox>
@@ -115,6 +117,32 @@ void MainWindow::removeRow() {
     m_removeRowPushButton->setEnabled(false);
 }
 
+void MainWindow::generateCms() {
+    const TargetSpectrum &uhs = m_motionLibrary->target();
+    if (uhs.isValid() == false) {
+        return;
+    }
+
+    bool ok;
+    const double condPeriod = QInputDialog::getDouble(
+            this, tr("Conditional Mean Spectrum"), tr("Conditioning period (s):"),
+            1.0, 0.01, 10., 3, &ok);
+    if (ok == false) {
+        return;
+    }
+
+    const double epsilon = QInputDialog::getDouble(
+            this, tr("Conditional Mean Spectrum"),
+            tr("Epsilon of the uniform hazard spectrum:"), 1.0, -5., 5., 2, &ok);
+    if (ok == false) {
+        return;
+    }
+
+    TargetSpectrum cms;
+    ConditionalMeanSpectrum(uhs, epsilon).generate(condPeriod, cms);
+    static_cast<InputTableModel *>(m_tableView->model())->setInput(cms);
+}
+
 void MainWindow::selectPath() {
     QString dir = QFileDialog::getExistingDirectory(
             this, tr("Select Directory"),
@@ -178,6 +206,20 @@ void MainWindow::updateMotionCount(int motionCount) {
     m_suiteSizeSpinBox->setMaximum(motionCount - 1);
 }
 
+void MainWindow::updateFilter(const QString &expression) {
+    m_motionLibrary->setFilter(expression);
+
+    if (m_motionLibrary->filterIsValid()) {
+        m_filterLineEdit->setStyleSheet(QString());
+        m_filterLineEdit->setToolTip(
+                tr("Only motions that satisfy all of the conditions are used. Fields: %1")
+                        .arg(MotionFilter::fieldNames().join(", ")));
+    } else {
+        m_filterLineEdit->setStyleSheet("QLineEdit { background-color: #ffd8d8; }");
+        m_filterLineEdit->setToolTip(m_motionLibrary->filterError());
+    }
+}
+
 void MainWindow::flagMotions() {
     if (m_motionLibrary->readMotions()) {
         FlagMotionsDialog dialog(m_motionLibrary->motions(), this);
@@ -282,6 +324,12 @@ void MainWindow::createPage() {
     connect(m_removeRowPushButton, SIGNAL(clicked()), this, SLOT(removeRow()));
     layout->addWidget(m_removeRowPushButton, 2, 2);
 
+    m_cmsPushButton = new QPushButton(tr("Conditional Mean..."));
+    m_cmsPushButton->setToolTip(
+            tr("Replace the uniform hazard spectrum with the conditional mean spectrum"));
+    connect(m_cmsPushButton, SIGNAL(clicked()), this, SLOT(generateCms()));
+    layout->addWidget(m_cmsPushButton, 3, 1, 1, 2);
+
     m_targetGroupBox = new QGroupBox(tr("Target Response Spectrum"));
     m_targetGroupBox->setLayout(layout);
 
@@ -334,8 +382,13 @@ void MainWindow::createPage() {
     connect(m_pathLineEdit, SIGNAL(textEdited(QString)), m_motionLibrary,
             SLOT(setMotionPath(QString)));
 
+    QPushButton *rescanButton = new QPushButton(tr("Rescan"));
+    rescanButton->setToolTip(tr("Count the motions in the path again."));
+    connect(rescanButton, SIGNAL(clicked()), m_motionLibrary, SLOT(rescanMotionPath()));
+
     row->addWidget(pushButton);
     row->addWidget(m_pathLineEdit);
+    row->addWidget(rescanButton);
     column->addLayout(row);
     row = new QHBoxLayout;
 
@@ -388,6 +441,37 @@ void MainWindow::createPage() {
     column->addLayout(row);
     row = new QHBoxLayout;
 
+    m_pairCombinationComboBox = new QComboBox;
+    m_pairCombinationComboBox->addItems(MotionPair::combinations());
+    m_pairCombinationComboBox->setToolTip(
+            tr("Spectrum of the combined components. RotD50 and RotD100 are the median and "
+               "maximum response over all rotation angles."));
+    connect(m_combinCheckBox, SIGNAL(toggled(bool)), m_pairCombinationComboBox,
+            SLOT(setEnabled(bool)));
+    connect(m_pairCombinationComboBox, SIGNAL(currentIndexChanged(int)), m_motionLibrary,
+            SLOT(setPairCombination(int)));
+
+    row->addWidget(new QLabel(tr("Combined spectrum:")));
+    row->addStretch();
+    row->addWidget(m_pairCombinationComboBox);
+    column->addLayout(row);
+    row = new QHBoxLayout;
+
+    m_filterLineEdit = new QLineEdit;
+    m_filterLineEdit->setPlaceholderText(tr("e.g. d5-95 between 10 and 40, pgv > 20"));
+    m_filterLineEdit->setToolTip(
+            tr("Only motions that satisfy all of the conditions are used. Fields: %1")
+                    .arg(MotionFilter::fieldNames().join(", ")));
+    // The filter is checked while it is typed, but errors are only reported
+    // once the selection starts
+    connect(m_filterLineEdit, SIGNAL(textChanged(QString)), this,
+            SLOT(updateFilter(QString)));
+
+    row->addWidget(new QLabel(tr("Filter:")));
+    row->addWidget(m_filterLineEdit);
+    column->addLayout(row);
+    row = new QHBoxLayout;
+
     QFrame *hLine = new QFrame;
     hLine->setFrameShape(QFrame::HLine);
     column->addWidget(hLine);
@@ -566,6 +650,9 @@ void MainWindow::loadValues() {
     m_minRequestedCountSpinBox->setValue(m_motionLibrary->minRequestedCount());
     m_stationCheckBox->setChecked(m_motionLibrary->oneMotionPerStation());
     m_combinCheckBox->setChecked(m_motionLibrary->combineComponents());
+    m_pairCombinationComboBox->setCurrentIndex(m_motionLibrary->pairCombination());
+    m_pairCombinationComboBox->setEnabled(m_motionLibrary->combineComponents());
+    m_filterLineEdit->setText(m_motionLibrary->filter());
 
     m_motionCountSpinBox->setValue(m_motionLibrary->motionCount());
     m_trialCountSpinBox->setValue(m_motionLibrary->trialCount());
@@ -58,6 +58,8 @@ public slots:
 
     void removeRow();
 
+    void generateCms();
+
     void selectPath();
 
     void compute();
@@ -70,6 +72,9 @@ protected slots:
 
     void updateMotionCount(int motionCount);
 
+    //! Set the filter and highlight the line edit if it is invalid
+    void updateFilter(const QString &expression);
+
     void flagMotions();
 
 signals:
@@ -112,6 +117,7 @@ private:
     QDoubleSpinBox *m_dampingSpinBox;
     QPushButton *m_addRowPushButton;
     QPushButton *m_removeRowPushButton;
+    QPushButton *m_cmsPushButton;
 
     QGroupBox *m_periodGroupBox;
     QComboBox *m_periodSpacingComboBox;
@@ -126,6 +132,8 @@ private:
     QSpinBox *m_suiteCountSpinBox;
     QCheckBox *m_stationCheckBox;
     QCheckBox *m_combinCheckBox;
+    QComboBox *m_pairCombinationComboBox;
+    QLineEdit *m_filterLineEdit;
     QSpinBox *m_minRequestedCountSpinBox;
     QSpinBox *m_motionCountSpinBox;
     QDoubleSpinBox *m_trialCountSpinBox;
@@ -20,16 +20,31 @@
 ////////////////////////////////////////////////////////////////////////////////////
 
 #include "Motion.h"
+#include "RecordReader.h"
 
 #include <QDir>
-#include <QRegExp>
-#include <QTextStream>
 #include <QtDebug>
 
 #include <gsl/gsl_fft_halfcomplex.h>
 
-Motion::Motion(const QString &fileName)
-    : AbstractMotion(), m_fileName(fileName) {}
+#include <algorithm>
+
+namespace {
+//! Damping of the oscillators of the Housner spectrum intensity
+const double HousnerDamping = 0.05;
+
+//! Peak absolute value of a series
+double peakOf(const double *x, const int n) {
+  double max = 0;
+  for (int j = 0; j < n; j++) {
+    max = qMax(max, fabs(x[j]));
+  }
+  return max;
+}
+}
+
+Motion::Motion(const QString &fileName, const SpectralContextPtr &context)
+    : AbstractMotion(context), m_fileName(fileName) {}
 
 Motion::~Motion() {}
 
@@ -53,19 +68,49 @@ const QString &Motion::component() const { return m_comp; }
 
 const QString &Motion::details() const { return m_details; }
 
+double Motion::dt() const { return m_dt; }
+
+bool Motion::isVertical(const QString &fileName) {
+  static const QLatin1String endings[] = {QLatin1String("-UP"), QLatin1String("UD"),
+                                          QLatin1String("-V"), QLatin1String("DN"),
+                                          QLatin1String("DWN")};
+
+  // Name without the extension
+  int dot = fileName.lastIndexOf('.');
+  if (dot < fileName.lastIndexOf('/')) {
+    dot = fileName.size();
+  }
+  const QStringRef baseName = fileName.leftRef(dot);
+
+  for (const QLatin1String &e : endings) {
+    if (baseName.endsWith(e, Qt::CaseInsensitive)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 int Motion::componentCount() const { return 1; }
 
 double Motion::dur5_75() const { return m_dur5_75; }
 
 double Motion::dur5_95() const { return m_dur5_95; }
 
-const QVector<double> &Motion::time() const { return m_time; }
+const TimeSeries &Motion::time() const { return m_time; }
 
-const QVector<double> &Motion::acc() const { return m_acc; }
+const TimeSeries &Motion::acc() const { return m_acc; }
 
-const QVector<double> &Motion::vel() const { return m_vel; }
+const TimeSeries &Motion::vel() const { return m_vel; }
 
-const QVector<double> &Motion::disp() const { return m_disp; }
+const TimeSeries &Motion::disp() const { return m_disp; }
+
+QVector<double> Motion::toDouble(const QVector<double> &series) { return series; }
+
+QVector<double> Motion::toDouble(const QVector<float> &series) {
+  QVector<double> values(series.size());
+  std::copy(series.constBegin(), series.constEnd(), values.begin());
+  return values;
+}
 
 double Motion::pga() const { return m_pga; }
 
@@ -73,6 +118,12 @@ double Motion::pgv() const { return m_pgv; }
 
 double Motion::pgd() const { return m_pgd; }
 
+double Motion::ariasInt() const { return m_ariasInt; }
+
+double Motion::cav() const { return m_cav; }
+
+double Motion::housnerInt() const { return m_housnerInt; }
+
 void Motion::scaleBy(const double factor) {
   // Scale factor relative to the previous
   const double relScale = factor / m_prevScale;
@@ -87,181 +138,297 @@ void Motion::scaleBy(const double factor) {
   m_pgv *= relScale;
   m_pgd *= relScale;
   m_ariasInt *= (relScale * relScale);
+  m_cav *= relScale;
+  m_housnerInt *= relScale;
 
   AbstractMotion::scaleBy(factor);
 }
 
-bool Motion::parseAt2Metadata(QFileInfo &fileInfo, QStringList &lines,
-                              int *count) {
-
-  /*
-   * AT2 files contain 4 header lines:
-   * (0) Not important
-   * (1) Event information
-   * (2) Not important
-   * (3) number of data points, time step
-   */
-  m_details = lines.at(1).trimmed();
-
-  // Read the event information and trim the white space
-  m_comp.clear();
-
-  // Try to determine the metadata from the details -- modern format supports
-  // this
-  QStringList parts = m_details.split(",");
-  if (parts.size() == 4) {
-    // Determine event, station, and component from header.
-    m_event = parts.at(0).trimmed();
-    m_station = parts.at(2).trimmed();
-    m_comp = parts.at(3).trimmed();
-  }
-
-  // The older formatted PEER motions require specific file structure.
-  if (m_comp.isEmpty()) {
-    QRegExp rx(".*/([^/]+)/"
-               "([^/]+)((?:\\d{3})|(?:-{0,2}[NSEWTLR]+)|"
-               "(?:NOR)|(?:SOU)|(?:EAS)|(?:WES))"
-               "(\\.AT2$)");
-    int pos = rx.indexIn(fileInfo.absoluteFilePath());
-    if (pos > -1) {
-      m_event = rx.cap(1);
-      m_station = rx.cap(2);
-      m_comp = rx.cap(3);
-    }
+bool Motion::processFile(bool withSpectrum) {
+  RecordReader::Record record;
+  if (RecordReader::readFile(m_fileName, record) == false) {
+    return false;
   }
 
-  // Read the number of data points and timestep
-  QList<QRegExp> patterns = {
-      // Example: 8751    0.0040    NPTS, DT
-      QRegExp("(\\d+)\\s+([0-9.]+)\\s+NPTS, DT"),
-      // Example: NPTS=   7998, DT=   .0050 SEC,
-      // Example: NPTS=   3666, DT=   0.025 SEC
-      QRegExp("NPTS=\\s+(\\d+), DT=\\s+([0-9.]+) SEC,?"),
-  };
-  *count = 0;
-  for (QRegExp &pattern : patterns) {
-    int pos = pattern.indexIn(lines.at(3));
-    if (pos < 0) {
-      continue;
-    }
-    *count = pattern.cap(1).toInt();
-    m_dt = pattern.cap(2).toDouble();
-    break;
-  }
+  m_event = record.event;
+  m_station = record.station;
+  m_comp = record.component;
+  m_details = record.details;
+  m_dt = record.dt;
 
-  return !m_comp.isEmpty() && (*count > 0);
+  process(record.acc, withSpectrum);
+  return true;
 }
 
-bool Motion::processFile() {
-  QFileInfo fileInfo(m_fileName);
-
-  if (fileInfo.isFile() == false) {
-    qCritical("File is not found!");
-  }
+bool Motion::processPacked(const PackedLibrary &library, int index, bool withSpectrum) {
+  const PackedLibrary::Record &record = library.record(index);
 
-  // Open the file
-  QFile file(fileInfo.absoluteFilePath());
-  file.open(QIODevice::ReadOnly | QIODevice::Text);
+  m_event = record.event;
+  m_station = record.station;
+  m_comp = record.component;
+  m_details = record.details;
+  m_dt = record.dt;
 
-  QTextStream fin(&file);
+  QVector<double> acc;
+  library.readAcc(index, acc);
 
-  // Number of data points
-  int n;
-  // Read the header based on file type
-  if (m_fileName.endsWith(".AT2", Qt::CaseInsensitive)) {
-    QStringList lines;
-    while (lines.size() < 4) {
-      lines += fin.readLine();
-    }
-    if (!parseAt2Metadata(fileInfo, lines, &n)) {
-      return false;
-    }
-  } else {
+  if (acc.isEmpty()) {
     return false;
   }
 
-  //
-  // Read the acceleration time history and compute the PGA
-  //
-  m_acc.resize(n);
-  m_time.resize(n);
+  process(acc, withSpectrum);
+  return true;
+}
+
+void Motion::process(const QVector<double> &acc, bool withSpectrum) {
+  const int n = acc.size();
 
+  m_time.resize(n);
   for (int i = 0; i < n; i++) {
-    fin >> m_acc[i];
     m_time[i] = m_dt * i;
   }
 
-  m_pga = findMaxAbs(m_acc);
+  m_acc.resize(n);
+  std::copy(acc.constBegin(), acc.constEnd(), m_acc.begin());
+
+  // Compute the velocity, displacement, peak values, and intensities
+  calcIntensityMeasures(acc);
 
-  // Compute the velocity, peak ground velocity, displacement and peak ground
-  // displacement.  The acceleration time series is scaled by gravity in
-  // units of cm/sec/sec.
+  // Compute the Fourier amplitude spectrum, which is kept for the spectra
+  // computed later, e.g. the RotD spectra of a pair
+  QVector<std::complex<double>> fas;
+  fft(acc, fas);
 
-  m_vel = cumtrapz(m_acc, m_dt, 980.665);
-  m_pgv = findMaxAbs(m_vel);
+  m_fasRe.resize(fas.size());
+  m_fasIm.resize(fas.size());
+  for (int i = 0; i < fas.size(); i++) {
+    m_fasRe[i] = fas.at(i).real();
+    m_fasIm[i] = fas.at(i).imag();
+  }
 
-  m_disp = cumtrapz(m_vel, m_dt);
-  m_pgd = findMaxAbs(m_disp);
+  m_sa.clear();
+  m_lnSa.clear();
+  m_masterLnSa.clear();
+  m_housnerInt = 0;
 
-  //
-  // Compute the Arias intensity
-  //
-  QVector<double> arias(n);
-  arias[0] = 0.0;
-  for (int i = 1; i < n; i++) {
-    arias[i] =
-        arias.at(i - 1) +
-        M_PI * 0.25 * m_dt * (pow(m_acc.at(i), 2) + pow(m_acc.at(i - 1), 2));
+  if (withSpectrum) {
+    calcSpectrum();
   }
+}
 
-  m_ariasInt = arias.last();
+bool Motion::hasSpectrum() const { return !m_sa.isEmpty(); }
 
+void Motion::calcSpectrum() {
   //
-  // Compute the durations based on the arias intensity
+  // The acceleration response spectrum is computed from the motion using a
+  // single-degree of freedom transfer function applied to the Fourier
+  // Amplitude spectrum.
   //
-  int i5 = 0;
-  int i75 = 0;
-  int i95 = 0;
+  // The response is computed at the master periods and then interpolated,
+  // which allows the periods to be changed without processing the motion
+  // again.
+  setSpectrum(calcRespSpec(damping(), spectrumPeriod()));
+}
 
-  for (int i = 0; i < n; i++) {
-    // Normalize the intensity relative to the maximum
-    double norm = arias.at(i) / m_ariasInt;
-    // Calculate the index values for 5, 75, and 95 percent intensities
-    if (norm < 0.05) {
-      ++i5;
+const QVector<double> &Motion::spectrumPeriod() const {
+  return m_context->isWithinMaster() ? SpectralContext::masterPeriod()
+                                     : period();
+}
+
+void Motion::setSpectrum(const QVector<double> &sa) {
+  // The spectrum is of the unscaled motion
+  if (scale() != 1.0) {
+    scaleBy(1.0);
+  }
+
+  if (m_context->isWithinMaster()) {
+    m_masterLnSa.resize(sa.size());
+    for (int i = 0; i < sa.size(); i++) {
+      m_masterLnSa[i] = log(sa.at(i));
     }
-    if (norm < 0.75) {
-      ++i75;
+
+    setContext(m_context);
+  } else {
+    m_masterLnSa.clear();
+    m_sa = sa;
+    calcLnSa();
+  }
+
+  // The Housner intensity is always computed on the same periods and at 5%
+  // damping, so that it does not depend on the period settings. At 5%
+  // damping the master spectrum is interpolated, otherwise the oscillators
+  // of the Housner periods are computed in addition.
+  const QVector<double> &housnerPeriod = housnerPeriods();
+  QVector<double> housnerSa;
+  if (!m_masterLnSa.isEmpty() && fabs(damping() - HousnerDamping) < 1e-9) {
+    static const SpectralContext housnerContext(housnerPeriod, HousnerDamping);
+    housnerContext.interpMaster(m_masterLnSa, housnerSa);
+    for (int i = 0; i < housnerSa.size(); i++) {
+      housnerSa[i] = exp(housnerSa.at(i));
     }
-    if (norm < 0.95) {
-      ++i95;
+  } else {
+    housnerSa = calcRespSpec(HousnerDamping, housnerPeriod);
+  }
+  m_housnerInt = calcHousnerInt(housnerPeriod, housnerSa);
+}
+
+const QVector<double> &Motion::housnerPeriods() {
+  static const QVector<double> period = [] {
+    // 0.1 to 2.5 sec in steps of 0.1 sec
+    QVector<double> values(25);
+    for (int i = 0; i < values.size(); ++i) {
+      values[i] = 0.1 * (i + 1);
     }
+    return values;
+  }();
+  return period;
+}
+
+void Motion::calcIntensityMeasures(const QVector<double> &accSeries) {
+  const int n = accSeries.size();
+
+  m_vel.resize(n);
+  m_disp.resize(n);
+
+  const double *acc = accSeries.constData();
+  Sample *vel = m_vel.data();
+  Sample *disp = m_disp.data();
+
+  // The acceleration time series is scaled by gravity in units of cm/sec/sec.
+  const double velScale = 980.665 * m_dt / 2.;
+  const double dispScale = m_dt / 2.;
+  const double ariasScale = M_PI * 0.25 * m_dt;
+  const double cavScale = m_dt / 2.;
+
+  vel[0] = 0.;
+  disp[0] = 0.;
+
+  double pga = fabs(acc[0]);
+  double pgv = 0.;
+  double pgd = 0.;
+  double arias = 0.;
+  double cav = 0.;
+
+  double accSqPrev = acc[0] * acc[0];
+  double absAccPrev = fabs(acc[0]);
+
+  // The integrals are carried in double precision, only the stored values
+  // are rounded
+  double velPrev = 0.;
+  double dispPrev = 0.;
+
+  // Single pass with the trapezoid rule for all of the integrals. Additional
+  // measures of the acceleration should be accumulated within this loop.
+  for (int i = 1; i < n; i++) {
+    const double absAcc = fabs(acc[i]);
+    const double accSq = acc[i] * acc[i];
+
+    const double v = velPrev + velScale * (acc[i] + acc[i - 1]);
+    const double d = dispPrev + dispScale * (v + velPrev);
+    vel[i] = v;
+    disp[i] = d;
+
+    arias += ariasScale * (accSq + accSqPrev);
+    cav += cavScale * (absAcc + absAccPrev);
+
+    pga = qMax(pga, absAcc);
+    pgv = qMax(pgv, fabs(v));
+    pgd = qMax(pgd, fabs(d));
+
+    accSqPrev = accSq;
+    absAccPrev = absAcc;
+    velPrev = v;
+    dispPrev = d;
   }
-  // Compute the durations
-  m_dur5_95 = m_dt * (i95 - i5);
-  m_dur5_75 = m_dt * (i75 - i5);
+
+  m_pga = pga;
+  m_pgv = pgv;
+  m_pgd = pgd;
+  m_ariasInt = arias;
+  m_cav = cav;
 
   //
-  // Compute the frequency QVector and Fourier amplitude spectrum
+  // Compute the durations based on the arias intensity. The limits depend on
+  // the total intensity, so the normalized Arias intensity is accumulated
+  // again and the pass stops once the last limit is crossed.
   //
-  // Compute the Fourier amplitude spectrum
-  QVector<std::complex<double>> fas;
-  fft(m_acc, fas);
+  const int limitCount = 3;
+  const double limits[limitCount] = {0.05 * arias, 0.75 * arias, 0.95 * arias};
+  int indices[limitCount] = {0, 0, 0};
+
+  if (arias > 0) {
+    int k = 0;
+    double sum = 0.;
+    for (int i = 0; i < n && k < limitCount; i++) {
+      if (i > 0) {
+        sum += ariasScale * (acc[i] * acc[i] + acc[i - 1] * acc[i - 1]);
+      }
+      // Index of the first value that is not less than the limit
+      while (k < limitCount && sum >= limits[k]) {
+        indices[k++] = i;
+      }
+    }
+    while (k < limitCount) {
+      indices[k++] = n;
+    }
+  }
+
+  m_dur5_75 = m_dt * (indices[1] - indices[0]);
+  m_dur5_95 = m_dt * (indices[2] - indices[0]);
+}
 
-  // Compute the frequency QVector
-  QVector<double> freq(fas.size());
-  double dFreq = 1 / (2 * m_dt * (freq.size() - 1));
-  for (int i = 0; i < freq.size(); i++) {
-    freq[i] = i * dFreq;
+double Motion::calcHousnerInt(const QVector<double> &period,
+                              const QVector<double> &sa) {
+  // Integrate the pseudo-spectral velocity (cm/sec) between 0.1 and 2.5 sec
+  const double minPeriod = 0.1;
+  const double maxPeriod = 2.5;
+
+  double sum = 0.;
+  for (int i = 1; i < period.size(); i++) {
+    const double periodA = period.at(i - 1);
+    const double periodB = period.at(i);
+
+    // Clip the interval to the limits
+    const double lower = qMax(periodA, minPeriod);
+    const double upper = qMin(periodB, maxPeriod);
+    if (upper <= lower) {
+      continue;
+    }
+
+    const double psvA = sa.at(i - 1) * 980.665 * periodA / (2 * M_PI);
+    const double psvB = sa.at(i) * 980.665 * periodB / (2 * M_PI);
+
+    // Linearly interpolate the velocity at the ends of the clipped interval
+    const double slope = (psvB - psvA) / (periodB - periodA);
+    const double psvLower = psvA + slope * (lower - periodA);
+    const double psvUpper = psvA + slope * (upper - periodA);
+
+    sum += (upper - lower) * (psvLower + psvUpper) / 2.;
   }
 
-  //
-  // The acceleration response spectrum is computed from the motion using a
-  // single-degree of freedom transfer function applied to the Fourier
-  // Amplitude spectrum.
-  //
-  m_sa = calcRespSpec(m_damping, m_period, freq, fas);
+  return sum;
+}
+
+void Motion::setContext(const SpectralContextPtr &context) {
+  Q_ASSERT(!m_masterLnSa.isEmpty() && m_context->canResampleTo(*context));
 
+  // Remove the previous scaling of the time series
+  scaleBy(1.0);
+
+  m_context = context;
+  m_context->interpMaster(m_masterLnSa, m_lnSa);
+
+  m_sa.resize(m_lnSa.size());
+  double sum = 0.0;
+  for (int i = 0; i < m_lnSa.size(); i++) {
+    m_sa[i] = exp(m_lnSa.at(i));
+    sum += m_lnSa.at(i);
+  }
+
+  m_avgLnSa = sum / m_lnSa.size();
+}
+
+void Motion::calcLnSa() {
   m_lnSa.resize(m_sa.size());
   // Compute the average response
   double sum = 0.0;
@@ -271,21 +438,28 @@ bool Motion::processFile() {
   }
 
   m_avgLnSa = sum / m_lnSa.size();
-
-  return true;
 }
 
 QVector<double> Motion::calcRespSpec(const double damping,
-                                     const QVector<double> &period,
-                                     const QVector<double> &freq,
-                                     const QVector<std::complex<double>> &fas) {
-  // Allocate the space for the response
+                                     const QVector<double> &period) const {
+  const int m = m_fasRe.size();
 
-  QVector<std::complex<double>> tf(fas.size());
-  QVector<double> ts;
-  QVector<double> sa(period.size());
+  QVector<double> freq;
+  QVector<double> freqSq;
+  QVector<double> fasRe;
+  QVector<double> fasIm;
+  loadFas(m, freq, freqSq, fasRe, fasIm);
 
+  // Buffer for the inverse FFT in the half-complex format. It is sized for
+  // the largest transform and reused for all of the periods.
   const double deltaFreq = 1 / (m_dt * m_time.size());
+  double maxFreq = 0;
+  for (int i = 0; i < period.size(); i++) {
+    maxFreq = qMax(maxFreq, 1 / period.at(i));
+  }
+  QVector<double> buf(2 * nextPow2(qMax(m, int((maxFreq * 5.0) / deltaFreq))));
+
+  QVector<double> sa(period.size());
 
   for (int i = 0; i < period.size(); i++) {
     const double f = 1 / period.at(i);
@@ -298,73 +472,105 @@ in the time domain. For example, at a frequency 100 Hz (period of 0.01
 sec) the FAS has to extend to 500 Hz. The FAS is initialized to be zero
 which allows for resolution of the time series.
 */
-    const int minsize = qMax(fas.size(), int((f * 5.0) / deltaFreq));
-    // Find the next power of 2
-    int n = 1;
-    while (n < minsize) {
-      n <<= 1;
-    }
-    QVector<std::complex<double>> Y(n, std::complex<double>(0., 0.));
+    const int n = nextPow2(qMax(m, int((f * 5.0) / deltaFreq)));
 
     // The amplitude of the FAS needs to be scaled to reflect the increased
     // number of points.
-    const double scale = double(Y.size()) / double(fas.size());
+    const double scale = double(n) / double(m);
 
     // Only apply the SDOF transfer function over frequencies defined by the
     // original motion
-    calcSdofTf(damping, f, freq, tf);
-    for (int j = 0; j < fas.size(); j++) {
-      Y[j] = scale * tf.at(j) * fas.at(j);
-    }
+    applySdofTf(damping, f, scale, freq.constData(), freqSq.constData(), fasRe.constData(),
+                fasIm.constData(), m, n, buf.data());
 
-    // Compute the inverse
-    ifft(Y, ts);
-    // Store the maximum
-    sa[i] = findMaxAbs(ts);
+    // Compute the inverse and store the maximum
+    gsl_fft_halfcomplex_radix2_inverse(buf.data(), 1, 2 * n);
+    sa[i] = peakOf(buf.constData(), 2 * n);
   }
 
   return sa;
 }
 
-void Motion::calcSdofTf(const double damping, const double fn,
-                        const QVector<double> &freq,
-                        QVector<std::complex<double>> &tf) {
-  for (int i = 0; i < freq.size(); i++) {
-    /*
-     * The single degree of freedom transfer function
-     *                          - fn^2
-     *  H = -------------------------------------------------
-     *       ( f^2 - fn^2 ) - 2 * sqrt(-1) * damping * fn * f
-     */
-    tf[i] = (-fn * fn) / std::complex<double>(freq.at(i) * freq.at(i) - fn * fn,
-                                              -2.0 * damping * fn * freq.at(i));
+void Motion::loadFas(const int m, QVector<double> &freq, QVector<double> &freqSq,
+                     QVector<double> &fasRe, QVector<double> &fasIm) const {
+  // The kept FAS is used, unless a longer padding is needed to match the
+  // other component of a pair
+  QVector<std::complex<double>> fas;
+  if (m != m_fasRe.size()) {
+    QVector<double> acc(m, 0.);
+    for (int i = 0; i < m_acc.size(); i++) {
+      acc[i] = m_acc.at(i) / scale();
+    }
+    fft(acc, fas);
+    Q_ASSERT(fas.size() == m);
   }
-}
 
-double Motion::findMaxAbs(const QVector<double> &v) {
-  //  Assume the first value is the largest
-  double max = fabs(v.at(0));
-  // Check the remaining values
-  for (int i = 1; i < v.size(); i++) {
-    if (fabs(v.at(i)) > max) {
-      max = fabs(v.at(i));
-    }
+  // Split the FAS into real and imaginary parts and precompute the squared
+  // frequency so that the inner loop of the kernel is plain arithmetic.
+  const double dFreq = 1 / (2 * m_dt * (m - 1));
+  freq.resize(m);
+  freqSq.resize(m);
+  fasRe.resize(m);
+  fasIm.resize(m);
+  for (int j = 0; j < m; j++) {
+    freq[j] = j * dFreq;
+    freqSq[j] = freq.at(j) * freq.at(j);
+    fasRe[j] = fas.isEmpty() ? m_fasRe.at(j) : fas.at(j).real();
+    fasIm[j] = fas.isEmpty() ? m_fasIm.at(j) : fas.at(j).imag();
   }
-  // Return the maximum
-  return max;
 }
 
-QVector<double> Motion::cumtrapz(const QVector<double> &ft, const double dt,
-                                 const double scale) {
-  QVector<double> gt(ft.size());
+void Motion::applySdofTf(const double damping, const double fn,
+                         const double scale, const double *freq,
+                         const double *freqSq,
+                         const double *fasRe, const double *fasIm,
+                         const int m, const int n, double *buf) {
+  /*
+   * The single degree of freedom transfer function
+   *                          - fn^2
+   *  H = -------------------------------------------------
+   *       ( f^2 - fn^2 ) - 2 * sqrt(-1) * damping * fn * f
+   *
+   * With a = f^2 - fn^2 and b = -2 * damping * fn * f, the product with the
+   * FAS is:
+   *
+   *  H * (Fr + i Fi) = c * ((a Fr + b Fi) + i (a Fi - b Fr))
+   *
+   * where c = -fn^2 / (a^2 + b^2).
+   *
+   * The result is written in the half-complex format of GSL with length 2n:
+   * the real parts in buf[0..n] and the imaginary parts in buf[2n - j].
+   */
+  const int size = 2 * n;
+  const double fnSq = fn * fn;
+  const double cNum = -fnSq * scale;
+  const double b0 = -2.0 * damping * fn;
+
+  // The last value of the transform is only real
+  const int count = (m < n) ? m : n - 1;
 
-  gt[0] = 0.0;
+  // At zero frequency H = 1 and only the real part is stored
+  buf[0] = scale * fasRe[0];
 
-  for (int i = 1; i < ft.size(); i++) {
-    gt[i] = gt.at(i - 1) + scale * dt * (ft.at(i) + ft.at(i - 1)) / 2.;
+  for (int j = 1; j < count; j++) {
+    const double a = freqSq[j] - fnSq;
+    const double b = b0 * freq[j];
+    const double c = cNum / (a * a + b * b);
+
+    buf[j] = c * (a * fasRe[j] + b * fasIm[j]);
+    buf[size - j] = c * (a * fasIm[j] - b * fasRe[j]);
   }
 
-  return gt;
+  std::fill(buf + count, buf + n, 0.);
+  std::fill(buf + n + 1, buf + size - count + 1, 0.);
+
+  if (count < m) {
+    const double a = freqSq[count] - fnSq;
+    const double b = b0 * freq[count];
+    buf[n] = cNum / (a * a + b * b) * (a * fasRe[count] + b * fasIm[count]);
+  } else {
+    buf[n] = 0.;
+  }
 }
 
 void Motion::fft(const QVector<double> &ts,
@@ -393,18 +599,184 @@ void Motion::fft(const QVector<double> &ts,
   fas[fas.size() - 1] = std::complex<double>(buf.at(n / 2), 0.0);
 }
 
-void Motion::ifft(const QVector<std::complex<double>> &fas,
-                  QVector<double> &ts) {
-  int n = 2 * fas.size();
-  QVector<double> buf = QVector<double>(n, 0.);
-  buf[0] = fas.first().real();
-  for (int i = 1; i < (fas.size() - 1); ++i) {
-    buf[i] = fas.at(i).real();
-    buf[n - i] = fas.at(i).imag();
+bool Motion::calcRotDSpec(Motion &motionA, Motion &motionB,
+                          const QVector<double> &period,
+                          QVector<double> &rotD50, QVector<double> &rotD100) {
+  if (fabs(motionA.m_dt - motionB.m_dt) > 1e-6 * motionA.m_dt) {
+    return false;
+  }
+
+  const double dt = motionA.m_dt;
+  const int count = qMax(motionA.m_acc.size(), motionB.m_acc.size());
+
+  // The kept FAS of the unscaled components, padded to a common length
+  const int m = qMax(motionA.m_fasRe.size(), motionB.m_fasRe.size());
+  QVector<double> freq;
+  QVector<double> freqSq;
+  QVector<double> reA;
+  QVector<double> imA;
+  QVector<double> reB;
+  QVector<double> imB;
+  motionA.loadFas(m, freq, freqSq, reA, imA);
+  {
+    QVector<double> freqB;
+    QVector<double> freqSqB;
+    motionB.loadFas(m, freqB, freqSqB, reB, imB);
+  }
+
+  // Components without a response spectrum take it from the same oscillator
+  // responses, so that they are only computed once
+  const bool withSpectrumA = !motionA.hasSpectrum() && period == motionA.spectrumPeriod();
+  const bool withSpectrumB = !motionB.hasSpectrum() && period == motionB.spectrumPeriod();
+  QVector<double> saA(withSpectrumA ? period.size() : 0);
+  QVector<double> saB(withSpectrumB ? period.size() : 0);
+
+  const double deltaFreq = 1 / (dt * count);
+  double maxFreq = 0;
+  for (int i = 0; i < period.size(); i++) {
+    maxFreq = qMax(maxFreq, 1 / period.at(i));
   }
-  buf[n / 2] = fas.last().real();
-  gsl_fft_halfcomplex_radix2_inverse(buf.data(), 1, n);
+  const int bufSize = 2 * nextPow2(qMax(m, int((maxFreq * 5.0) / deltaFreq)));
+  QVector<double> bufA(bufSize);
+  QVector<double> bufB(bufSize);
+  QVector<double> points;
+  QVector<double> peaks;
+
+  const double damping = motionA.damping();
+  rotD50.resize(period.size());
+  rotD100.resize(period.size());
+
+  for (int i = 0; i < period.size(); i++) {
+    const double f = 1 / period.at(i);
+    const int n = nextPow2(qMax(m, int((f * 5.0) / deltaFreq)));
+    const double scale = double(n) / double(m);
 
-  ts.resize(n);
-  std::copy(buf.begin(), buf.end(), ts.begin());
+    applySdofTf(damping, f, scale, freq.constData(), freqSq.constData(), reA.constData(),
+                imA.constData(), m, n, bufA.data());
+    applySdofTf(damping, f, scale, freq.constData(), freqSq.constData(), reB.constData(),
+                imB.constData(), m, n, bufB.data());
+
+    gsl_fft_halfcomplex_radix2_inverse(bufA.data(), 1, 2 * n);
+    gsl_fft_halfcomplex_radix2_inverse(bufB.data(), 1, 2 * n);
+
+    if (withSpectrumA) {
+      saA[i] = peakOf(bufA.constData(), 2 * n);
+    }
+    if (withSpectrumB) {
+      saB[i] = peakOf(bufB.constData(), 2 * n);
+    }
+
+    calcRotD(bufA.constData(), bufB.constData(), 2 * n, points, peaks, &rotD50[i], &rotD100[i]);
+  }
+
+  if (withSpectrumA) {
+    motionA.setSpectrum(saA);
+  }
+  if (withSpectrumB) {
+    motionB.setSpectrum(saB);
+  }
+
+  return true;
+}
+
+void Motion::calcRotD(const double *x, const double *y, const int n,
+                      QVector<double> &points, QVector<double> &peaks,
+                      double *rotD50, double *rotD100) {
+  // Rotation angles of 0 to 179 degrees
+  const int angleCount = 180;
+  static const QVector<double> cosAngle = [] {
+    QVector<double> v(angleCount);
+    for (int k = 0; k < angleCount; k++) {
+      v[k] = cos(k * M_PI / angleCount);
+    }
+    return v;
+  }();
+  static const QVector<double> sinAngle = [] {
+    QVector<double> v(angleCount);
+    for (int k = 0; k < angleCount; k++) {
+      v[k] = sin(k * M_PI / angleCount);
+    }
+    return v;
+  }();
+
+  // The points with the largest projection in eight directions, along with
+  // their reflections, form a polygon inside of the trajectory. A point
+  // closer to the origin than every edge of the polygon cannot be a peak.
+  const int dirCount = 8;
+  double qx[dirCount];
+  double qy[dirCount];
+  for (int k = 0; k < dirCount; k++) {
+    const double c = cos(k * M_PI / dirCount);
+    const double s = sin(k * M_PI / dirCount);
+
+    double best = -1;
+    qx[k] = 0;
+    qy[k] = 0;
+    for (int j = 0; j < n; j++) {
+      const double p = x[j] * c + y[j] * s;
+      if (fabs(p) > best) {
+        best = fabs(p);
+        // Reflect the point to the side of the direction
+        qx[k] = (p < 0) ? -x[j] : x[j];
+        qy[k] = (p < 0) ? -y[j] : y[j];
+      }
+    }
+  }
+
+  double minDist = -1;
+  for (int k = 0; k < 2 * dirCount; k++) {
+    const int a = k % dirCount;
+    const int b = (k + 1) % dirCount;
+    // The second half of the polygon is reflected through the origin
+    const double ax = (k < dirCount) ? qx[a] : -qx[a];
+    const double ay = (k < dirCount) ? qy[a] : -qy[a];
+    const double bx = (k + 1 < dirCount || k + 1 == 2 * dirCount) ? qx[b] : -qx[b];
+    const double by = (k + 1 < dirCount || k + 1 == 2 * dirCount) ? qy[b] : -qy[b];
+
+    const double length = hypot(bx - ax, by - ay);
+    if (length > 0) {
+      const double dist = fabs(ax * by - ay * bx) / length;
+      minDist = (minDist < 0) ? dist : qMin(minDist, dist);
+    }
+  }
+  const double minDistSq = (minDist < 0) ? 0 : minDist * minDist;
+
+  points.resize(0);
+  for (int j = 0; j < n; j++) {
+    if (x[j] * x[j] + y[j] * y[j] >= minDistSq) {
+      points << x[j] << y[j];
+    }
+  }
+
+  // Peak at each angle from the remaining points
+  peaks.resize(angleCount);
+  const double *p = points.constData();
+  const int count = points.size() / 2;
+  for (int k = 0; k < angleCount; k++) {
+    const double c = cosAngle.at(k);
+    const double s = sinAngle.at(k);
+
+    double max = 0;
+    for (int j = 0; j < count; j++) {
+      max = qMax(max, fabs(p[2 * j] * c + p[2 * j + 1] * s));
+    }
+    peaks[k] = max;
+  }
+
+  *rotD100 = *std::max_element(peaks.constBegin(), peaks.constEnd());
+
+  // Median of an even number of values
+  std::nth_element(peaks.begin(), peaks.begin() + angleCount / 2, peaks.end());
+  const double upper = peaks.at(angleCount / 2);
+  const double lower =
+      *std::max_element(peaks.constBegin(), peaks.constBegin() + angleCount / 2);
+  *rotD50 = (lower + upper) / 2.;
+}
+
+int Motion::nextPow2(const int minsize) {
+  int n = 1;
+  while (n < minsize) {
+    n <<= 1;
+  }
+  return n;
 }
@@ -21,18 +21,50 @@
 #define MOTION_H_
 
 #include "AbstractMotion.h"
+#include "PackedLibrary.h"
 
 #include <QFileInfo>
 #include <QStringList>
 
+/*! Storage of the time series and the kept Fourier amplitude spectrum.
+ * Records have about six significant digits, so the series can be stored in
+ * single precision by building with SIGMASPECTRA_SINGLE_PRECISION, which
+ * halves their memory. The response spectra and intensity measures are
+ * always computed in double precision.
+ */
+#ifdef SIGMASPECTRA_SINGLE_PRECISION
+typedef float Sample;
+#else
+typedef double Sample;
+#endif
+
+typedef QVector<Sample> TimeSeries;
+
 class Motion : public AbstractMotion {
 public:
-  Motion(const QString &fileName = "");
+  Motion(const QString &fileName, const SpectralContextPtr &context);
 
   ~Motion();
 
-  //! Read the file and compute the response spectrum
-  bool processFile();
+  /*! Read the file and compute the response spectrum.
+   * \param withSpectrum if false, the response spectrum is left to
+   * calcSpectrum() or calcRotDSpec()
+   */
+  bool processFile(bool withSpectrum = true);
+
+  /*! Read the record from a packed library and compute the response spectrum.
+   * \param library opened packed library
+   * \param index index of the record in the library
+   * \param withSpectrum if false, the response spectrum is left to
+   * calcSpectrum() or calcRotDSpec()
+   */
+  bool processPacked(const PackedLibrary &library, int index, bool withSpectrum = true);
+
+  //! If the response spectrum has been computed
+  bool hasSpectrum() const;
+
+  //! Compute the response spectrum of a motion processed without it
+  void calcSpectrum();
 
   virtual QString name() const;
 
@@ -42,19 +74,30 @@ public:
 
   const QString &details() const;
 
+  //! Time step (sec)
+  double dt() const;
+
+  //! Check if the name of a record file indicates a vertical component
+  static bool isVertical(const QString &fileName);
+
   virtual int componentCount() const;
 
   double dur5_75() const;
 
   double dur5_95() const;
 
-  const QVector<double> &time() const;
+  const TimeSeries &time() const;
 
-  const QVector<double> &acc() const;
+  const TimeSeries &acc() const;
 
-  const QVector<double> &vel() const;
+  const TimeSeries &vel() const;
 
-  const QVector<double> &disp() const;
+  const TimeSeries &disp() const;
+
+  //! Time series in double precision -- shared without a copy if stored as double
+  static QVector<double> toDouble(const QVector<double> &series);
+
+  static QVector<double> toDouble(const QVector<float> &series);
 
   double pga() const;
 
@@ -62,31 +105,91 @@ public:
 
   double pgv() const;
 
+  //! Arias intensity
+  double ariasInt() const;
+
+  //! Cumulative absolute velocity in g-sec
+  double cav() const;
+
+  //! Housner spectrum intensity in cm -- computed at 5% damping
+  double housnerInt() const;
+
   //! Scale the properties of the motion by a factor
   void scaleBy(const double factor);
 
+  //! Interpolate the response spectrum from the master spectrum
+  void setContext(const SpectralContextPtr &context);
+
+  /*! Compute the RotD50 and RotD100 response spectra of two horizontal
+   * components. The oscillator response of both components is computed for
+   * each period and the peak response is found for rotation angles of 0 to
+   * 179 degrees. The spectra are of the unscaled components. A component
+   * without a response spectrum gets it from the same oscillator responses,
+   * if the periods are those of its spectrum.
+   * \param motionA first component
+   * \param motionB second component
+   * \param period natural periods of the oscillators
+   * \param rotD50 median of the peak response over the angles
+   * \param rotD100 maximum of the peak response over the angles
+   * \return false if the components have different time steps
+   */
+  static bool calcRotDSpec(Motion &motionA, Motion &motionB,
+                           const QVector<double> &period,
+                           QVector<double> &rotD50, QVector<double> &rotD100);
+
 protected:
-  //! Parse metadata from the header lines and filename
-  bool parseAt2Metadata(QFileInfo &fileInfo, QStringList &lines, int *count);
+  /*! Compute the time series, Fourier amplitude spectrum, and response
+   * spectrum from the acceleration, which are then stored.
+   * \param acc acceleration in g as read
+   * \param withSpectrum if the response spectrum is computed
+   */
+  void process(const QVector<double> &acc, bool withSpectrum);
+
+  //! Periods of the stored spectrum -- the master periods if within them
+  const QVector<double> &spectrumPeriod() const;
 
-  /*! Compute the acceleration response spectrum.
+  /*! Store the unscaled response spectrum and compute the Housner intensity.
+   * \param sa response spectrum at spectrumPeriod()
+   */
+  void setSpectrum(const QVector<double> &sa);
+
+  /*! Compute the acceleration response spectrum from the stored FAS.
    * \param damping damping of the oscillators
    * \param period natural periods of the oscillators
-   * \param freq frequency of the Fourier amplitude spectrum
-   * \param fas Fourier amplitude spectrum
    * \return response spectrum
    */
   QVector<double> calcRespSpec(const double damping,
-                               const QVector<double> &period,
-                               const QVector<double> &freq,
-                               const QVector<std::complex<double>> &fas);
+                               const QVector<double> &period) const;
+
+  /*! Frequency and split FAS of the unscaled motion in double precision.
+   * \param m number of frequencies, a longer FAS is computed again from the
+   * acceleration padded to that length
+   * \param freq frequency of the FAS
+   * \param freqSq squared frequency of the FAS
+   * \param fasRe real part of the FAS
+   * \param fasIm imaginary part of the FAS
+   */
+  void loadFas(const int m, QVector<double> &freq, QVector<double> &freqSq,
+               QVector<double> &fasRe, QVector<double> &fasIm) const;
+
+  /*! Compute the velocity, displacement, peak values, Arias intensity, CAV,
+   * and the significant durations from the acceleration.
+   * The integrals and peaks are computed in a single pass without temporary
+   * arrays and accumulated in double precision.
+   */
+  void calcIntensityMeasures(const QVector<double> &acc);
+
+  /*! Housner spectrum intensity from the response spectrum.
+   * Intervals crossing the limits of 0.1 and 2.5 sec are clipped.
+   */
+  static double calcHousnerInt(const QVector<double> &period,
+                               const QVector<double> &sa);
 
-  //! Cumulative integration by the trapezoid rule
-  static QVector<double> cumtrapz(const QVector<double> &ft, const double dt,
-                                  const double scale = 1.0);
+  //! Periods used for the Housner spectrum intensity
+  static const QVector<double> &housnerPeriods();
 
-  //! Find the maximum absolute value of a vector
-  static double findMaxAbs(const QVector<double> &);
+  //! Compute the log and average of the response spectrum from m_sa
+  void calcLnSa();
 
   /*! Forward Fast Fourier Transform (FFT).
    * \param ts time series
@@ -95,22 +198,46 @@ protected:
   static void fft(const QVector<double> &ts,
                   QVector<std::complex<double>> &fas);
 
-  /*! Inverse Fast Fourier Transform (IFFT).
-   * \param fas Fourier amplitude spectrum
-   * \param ts time series
-   */
-  static void ifft(const QVector<std::complex<double>> &fas,
-                   QVector<double> &ts);
-
-  /*! Compute a single-degree of freedom transfer function.
+  /*! Apply a single-degree of freedom transfer function to the FAS.
+   * The product is written directly into the half-complex buffer used by the
+   * inverse FFT of GSL, with zeros beyond the frequencies of the FAS. The
+   * kernel works on split real and imaginary arrays and does not allocate.
    * \param damping damping of the oscillator
    * \param fn natural frequency of the oscillator
-   * \param freq frequency of the Fourier amplitude spectrum
-   * \param tf reference to the transfer function
+   * \param scale scale applied to the amplitude of the FAS
+   * \param freq frequency of the FAS
+   * \param freqSq squared frequency of the FAS
+   * \param fasRe real part of the FAS
+   * \param fasIm imaginary part of the FAS
+   * \param m number of frequencies of the FAS
+   * \param n number of frequencies of the padded FAS
+   * \param buf buffer of at least 2n values
+   */
+  static void applySdofTf(const double damping, const double fn,
+                          const double scale, const double *freq,
+                          const double *freqSq, const double *fasRe,
+                          const double *fasIm, const int m, const int n,
+                          double *buf);
+
+  //! Smallest power of two that is not less than minsize
+  static int nextPow2(const int minsize);
+
+  /*! Compute the peak response of two orthogonal oscillators rotated over
+   * the angles. The peak at an angle is the largest projection of the
+   * trajectory (x, y), so only the points that are outside of a polygon
+   * inscribed in the trajectory can be a peak. These points are found first
+   * and the angles are then checked against them alone.
+   * \param x response of the first oscillator
+   * \param y response of the second oscillator
+   * \param n number of values
+   * \param points buffer for the remaining points
+   * \param peaks peak response at each angle
+   * \param rotD50 median of the peaks
+   * \param rotD100 maximum of the peaks
    */
-  static void calcSdofTf(const double damping, const double fn,
-                         const QVector<double> &freq,
-                         QVector<std::complex<double>> &tf);
+  static void calcRotD(const double *x, const double *y, const int n,
+                       QVector<double> &points, QVector<double> &peaks,
+                       double *rotD50, double *rotD100);
 
   //! Filename
   QString m_fileName;
@@ -126,16 +253,27 @@ protected:
   double m_dt;
 
   //! Time values
-  QVector<double> m_time;
+  TimeSeries m_time;
 
   //! Acceleration values in g
-  QVector<double> m_acc;
+  TimeSeries m_acc;
 
   //! Velocity values in LENGTH/second (based on gravity)
-  QVector<double> m_vel;
+  TimeSeries m_vel;
 
   //! Displacement values in LENGTH (based on gravity)
-  QVector<double> m_disp;
+  TimeSeries m_disp;
+
+  //! Fourier amplitude spectrum of the unscaled acceleration, split into
+  //! the real and imaginary parts
+  //@{
+  TimeSeries m_fasRe;
+  TimeSeries m_fasIm;
+  //@}
+
+  //! Natural log of the unscaled response spectrum at the master periods.
+  //! Empty if the periods of the context are outside of the master periods.
+  QVector<double> m_masterLnSa;
 
   //! Peak ground acceleration
   double m_pga;
@@ -149,6 +287,12 @@ protected:
   //! Arias intensity of the motion
   double m_ariasInt;
 
+  //! Cumulative absolute velocity in g-sec
+  double m_cav;
+
+  //! Housner spectrum intensity in cm
+  double m_housnerInt;
+
   //! Durations
   //@{
   //! 5 to 75 percent of the Arias intensity
@@ -0,0 +1,279 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#include "MotionFilter.h"
+#include "Motion.h"
+#include "MotionPair.h"
+
+#include <QRegExp>
+
+namespace {
+    //! Number of numeric fields, which come first in Field
+    const int NumericFieldCount = MotionFilter::EventField;
+
+    //! Scalar of a single component
+    double componentValue(const Motion *motion, MotionFilter::Field field) {
+        switch (field) {
+            case MotionFilter::PgaField:
+                return motion->pga();
+            case MotionFilter::PgvField:
+                return motion->pgv();
+            case MotionFilter::PgdField:
+                return motion->pgd();
+            case MotionFilter::Dur5_75Field:
+                return motion->dur5_75();
+            case MotionFilter::Dur5_95Field:
+                return motion->dur5_95();
+            case MotionFilter::AriasField:
+                return motion->ariasInt();
+            case MotionFilter::CavField:
+                return motion->cav();
+            default:
+                return 0;
+        }
+    }
+}
+
+MotionFilter::MotionFilter()
+        : m_isValid(true), m_count(0) {
+}
+
+const QString &MotionFilter::expression() const {
+    return m_expression;
+}
+
+bool MotionFilter::setExpression(const QString &expression) {
+    m_expression = expression;
+    m_conditions.clear();
+    m_isValid = true;
+    m_errorString.clear();
+
+    // Conditions are separated by semicolons, or by commas that are followed
+    // by a field name, so that a text value may contain commas
+    QStringList names;
+    for (const QString &name : fieldNames()) {
+        names << QRegExp::escape(name);
+    }
+    names << "dur5_\\d+";
+    const QRegExp separator(QString(";|,(?=\\s*(?:%1)(?![\\w\\-]))").arg(names.join("|")),
+                            Qt::CaseInsensitive);
+
+    for (const QString &part : expression.split(separator, QString::SkipEmptyParts)) {
+        if (part.trimmed().isEmpty()) {
+            continue;
+        }
+
+        Condition condition;
+        if (parseCondition(part, condition) == false) {
+            m_errorString = QString("Invalid filter condition: %1").arg(part.trimmed());
+            m_conditions.clear();
+            m_isValid = false;
+            break;
+        }
+        m_conditions << condition;
+    }
+
+    return m_isValid;
+}
+
+bool MotionFilter::isValid() const {
+    return m_isValid;
+}
+
+const QString &MotionFilter::errorString() const {
+    return m_errorString;
+}
+
+bool MotionFilter::isActive() const {
+    return !m_conditions.isEmpty();
+}
+
+QStringList MotionFilter::fieldNames() {
+    // Order matches Field
+    return QStringList() << "pga"
+                         << "pgv"
+                         << "pgd"
+                         << "d5-75"
+                         << "d5-95"
+                         << "arias"
+                         << "cav"
+                         << "event"
+                         << "station";
+}
+
+bool MotionFilter::isTextField(Field field) {
+    return field == EventField || field == StationField;
+}
+
+bool MotionFilter::parseCondition(const QString &text, Condition &condition) {
+    QRegExp rxBetween("^\\s*([\\w\\-]+)\\s+between\\s+(\\S+)\\s+and\\s+(\\S+)\\s*$",
+                      Qt::CaseInsensitive);
+    QRegExp rxCompare("^\\s*([\\w\\-]+)\\s*(<=|>=|!=|<|>|=|~)\\s*(.+)$");
+
+    QString name;
+    QStringList values;
+    if (rxBetween.indexIn(text) > -1) {
+        name = rxBetween.cap(1);
+        condition.op = Between;
+        values << rxBetween.cap(2) << rxBetween.cap(3);
+    } else if (rxCompare.indexIn(text) > -1) {
+        name = rxCompare.cap(1);
+        values << rxCompare.cap(3).trimmed();
+
+        const QString op = rxCompare.cap(2);
+        if (op == "<") {
+            condition.op = Less;
+        } else if (op == "<=") {
+            condition.op = LessEqual;
+        } else if (op == ">") {
+            condition.op = Greater;
+        } else if (op == ">=") {
+            condition.op = GreaterEqual;
+        } else if (op == "=") {
+            condition.op = Equal;
+        } else if (op == "!=") {
+            condition.op = NotEqual;
+        } else {
+            condition.op = Contains;
+        }
+    } else {
+        return false;
+    }
+
+    // Accept the names of the accessors as well
+    name = name.toLower().replace("dur5_", "d5-");
+    const int field = fieldNames().indexOf(name);
+    if (field < 0) {
+        return false;
+    }
+    condition.field = (Field)field;
+
+    if (isTextField(condition.field)) {
+        if (condition.op != Equal && condition.op != NotEqual && condition.op != Contains) {
+            return false;
+        }
+        condition.text = values.first();
+        return true;
+    }
+
+    if (condition.op == Contains) {
+        return false;
+    }
+
+    bool ok;
+    condition.lower = values.first().toDouble(&ok);
+    if (ok == false) {
+        return false;
+    }
+    condition.upper = condition.lower;
+
+    if (condition.op == Between) {
+        condition.upper = values.last().toDouble(&ok);
+        if (ok == false || condition.upper < condition.lower) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MotionFilter::build(const QList<AbstractMotion *> &motions) {
+    m_count = motions.size();
+    m_values.fill(QVector<double>(m_count), NumericFieldCount);
+    m_events.clear();
+    m_stations.clear();
+
+    for (int i = 0; i < m_count; ++i) {
+        const AbstractMotion *am = motions.at(i);
+        m_events << am->event();
+        m_stations << am->station();
+
+        QList<const Motion *> components;
+        if (const MotionPair *mp = dynamic_cast<const MotionPair *>(am)) {
+            components << mp->motionA() << mp->motionB();
+        } else if (const Motion *m = dynamic_cast<const Motion *>(am)) {
+            components << m;
+        }
+
+        for (int f = 0; f < NumericFieldCount; ++f) {
+            double sum = 0;
+            for (const Motion *m : components) {
+                sum += componentValue(m, (Field)f);
+            }
+            m_values[f][i] = components.isEmpty() ? 0 : sum / components.size();
+        }
+    }
+}
+
+QBitArray MotionFilter::mask() const {
+    QBitArray mask(m_count, true);
+
+    for (const Condition &c : m_conditions) {
+        if (isTextField(c.field)) {
+            const QStringList &names = (c.field == EventField) ? m_events : m_stations;
+            for (int i = 0; i < m_count; ++i) {
+                bool pass;
+                if (c.op == Contains) {
+                    pass = names.at(i).contains(c.text, Qt::CaseInsensitive);
+                } else {
+                    pass = (names.at(i).compare(c.text, Qt::CaseInsensitive) == 0) == (c.op == Equal);
+                }
+                if (pass == false) {
+                    mask.clearBit(i);
+                }
+            }
+            continue;
+        }
+
+        const double *values = m_values.at(c.field).constData();
+        for (int i = 0; i < m_count; ++i) {
+            const double v = values[i];
+            bool pass;
+            switch (c.op) {
+                case Less:
+                    pass = v < c.lower;
+                    break;
+                case LessEqual:
+                    pass = v <= c.lower;
+                    break;
+                case Greater:
+                    pass = v > c.lower;
+                    break;
+                case GreaterEqual:
+                    pass = v >= c.lower;
+                    break;
+                case Equal:
+                    pass = v == c.lower;
+                    break;
+                case NotEqual:
+                    pass = v != c.lower;
+                    break;
+                case Between:
+                    pass = c.lower <= v && v <= c.upper;
+                    break;
+                default:
+                    pass = true;
+            }
+            if (pass == false) {
+                mask.clearBit(i);
+            }
+        }
+    }
+
+    return mask;
+}
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MOTION_FILTER_H_
+#define MOTION_FILTER_H_
+
+#include "AbstractMotion.h"
+
+#include <QBitArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*! MotionFilter screens the motions by their intensity measures before the
+ * selection.
+ *
+ * The filter expression is a list of conditions separated by semicolons, or
+ * by commas followed by a field name, all of which must be satisfied. For
+ * example:
+ *
+ *   d5-95 between 10 and 40, pgv > 20, event ~ northridge, ca
+ *
+ * Numeric fields support <, <=, >, >=, =, != and "between a and b". The event
+ * and station fields support = (equal), != (not equal) and ~ (contains),
+ * ignoring case. The numeric fields of a pair of components are the average of
+ * the two components.
+ *
+ * The scalars of the motions are stored by column, so that each condition is
+ * evaluated with one pass over a contiguous array.
+ */
+class MotionFilter {
+public:
+    enum Field {
+        PgaField, //!< Peak ground acceleration (g)
+        PgvField, //!< Peak ground velocity (cm/sec)
+        PgdField, //!< Peak ground displacement (cm)
+        Dur5_75Field, //!< 5 to 75 percent significant duration (sec)
+        Dur5_95Field, //!< 5 to 95 percent significant duration (sec)
+        AriasField, //!< Arias intensity
+        CavField, //!< Cumulative absolute velocity (g-sec)
+        EventField, //!< Event name
+        StationField, //!< Station name
+    };
+
+    MotionFilter();
+
+    //! Filter expression
+    const QString &expression() const;
+
+    /*! Set and compile the expression. Nothing is reported, as the
+     * expression may be incomplete while it is typed; see errorString().
+     * \param expression filter expression, empty to accept all motions
+     * \return true if the expression was valid
+     */
+    bool setExpression(const QString &expression);
+
+    //! If the expression was compiled successfully
+    bool isValid() const;
+
+    //! Description of the invalid condition of the expression
+    const QString &errorString() const;
+
+    //! If the expression has at least one condition
+    bool isActive() const;
+
+    //! Names of the fields accepted in the expression
+    static QStringList fieldNames();
+
+    //! Store the scalars of the motions
+    void build(const QList<AbstractMotion *> &motions);
+
+    /*! Evaluate the filter on the motions provided to build().
+     * \return bit for each motion that is set if it passes all conditions
+     */
+    QBitArray mask() const;
+
+private:
+    enum Operator {
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Equal,
+        NotEqual,
+        Between,
+        Contains,
+    };
+
+    struct Condition {
+        Field field;
+        Operator op;
+        double lower;
+        double upper;
+        QString text;
+    };
+
+    //! Parse a single condition
+    static bool parseCondition(const QString &text, Condition &condition);
+
+    //! Check if the field contains text
+    static bool isTextField(Field field);
+
+    //! Filter expression
+    QString m_expression;
+
+    //! If the expression was valid
+    bool m_isValid;
+
+    QString m_errorString;
+
+    //! Compiled conditions
+    QList<Condition> m_conditions;
+
+    //! Number of motions in the index
+    int m_count;
+
+    //! Numeric scalars of the motions stored by field
+    QVector<QVector<double>> m_values;
+
+    //! Event names of the motions
+    QStringList m_events;
+
+    //! Station names of the motions
+    QStringList m_stations;
+};
+
+#endif
@@ -21,17 +21,25 @@
 
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <algorithm>
 
 #include "MotionLibrary.h"
+#include "DirectoryScanner.h"
 #include "MotionPair.h"
-
-#include <gsl/gsl_interp.h>
-#include <gsl/gsl_spline.h>
+#include "PackedLibrary.h"
+#include "RecordReader.h"
+#include "SeedSpace.h"
+#include "SelectionCheckpoint.h"
 
 #include <QApplication>
+#include <QCryptographicHash>
 #include <QElapsedTimer>
 #include <QDir>
 #include <QDirIterator>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
 #include <QSettings>
 #include <QTime>
 #include <QtDebug>
@@ -41,7 +49,16 @@ MotionLibrary::MotionLibrary() {
     m_motionCount = 0;
     m_disabledCount = 0;
     m_motionsNeedProcessing = true;
-    m_worstLoc = -1;
+    m_checkpointInterval = 300;
+    m_resume = false;
+    m_shardIndex = 0;
+    m_shardCount = 1;
+
+    m_scanner = new DirectoryScanner(this);
+    connect(m_scanner, SIGNAL(countChanged(QString, int)), this,
+            SLOT(setMotionCount(QString, int)));
+    connect(m_scanner, SIGNAL(scanFailed(QString, QString)), this,
+            SLOT(reportScanError(QString, QString)));
 
     QSettings settings;
     // Default period vector
@@ -58,78 +75,73 @@ MotionLibrary::MotionLibrary() {
         settings.value("library/oneMotionPerStation", true).toBool();
     m_combineComponents =
         settings.value("library/combineComponents", false).toBool();
+    m_pairCombination = (MotionPair::Combination)settings
+        .value("library/pairCombination", MotionPair::GeometricMean).toInt();
 
     m_seedSize = settings.value("library/seedSize", 2).toInt();
     m_suiteSize = settings.value("library/suiteSize", 7).toInt();
     m_suiteCount = settings.value("library/suiteCount", 10).toInt();
     m_minRequestedCount = settings.value("library/minRequestedCount", 0).toInt();
+    m_filter.setExpression(settings.value("library/filter", "").toString());
 
     setMotionPath(settings.value("library/motionPath", "").toString());
 }
 
 MotionLibrary::~MotionLibrary() {}
 
-QVector<double> &MotionLibrary::inputPeriod() { return m_inputPeriod; }
+QVector<double> &MotionLibrary::inputPeriod() { return m_target.inputPeriod(); }
 
-QVector<double> &MotionLibrary::inputSa() { return m_inputSa; }
+QVector<double> &MotionLibrary::inputSa() { return m_target.inputSa(); }
 
-QVector<double> &MotionLibrary::inputLnStd() { return m_inputLnStd; }
+QVector<double> &MotionLibrary::inputLnStd() { return m_target.inputLnStd(); }
+
+const TargetSpectrum &MotionLibrary::target() const { return m_target; }
 
 const QVector<double> &MotionLibrary::period() const { return m_period; }
 
-const QVector<double> &MotionLibrary::targetSa() const { return m_targetSa; }
+const QVector<double> &MotionLibrary::targetSa() const { return m_target.sa(); }
 
 const QVector<double> &MotionLibrary::targetLnStd() const {
-    return m_targetLnStd;
+    return m_target.lnStd();
 }
 
 QVector<double> MotionLibrary::targetFracile(double eps) const {
-    QVector<double> values(m_targetLnSa.size());
-    for (int i = 0; i < m_targetLnSa.size(); ++i) {
-        values[i] = exp(eps * m_targetLnStd.at(i) + m_targetLnSa.at(i));
-    }
-    return values;
+    return m_target.fractile(eps);
 }
 
 double MotionLibrary::damping() const { return m_damping; }
 
 void MotionLibrary::setDamping(double damping) {
     m_damping = damping;
-    m_motionsNeedProcessing = true;
 }
 
 int MotionLibrary::periodCount() const { return m_periodCount; }
 
 void MotionLibrary::setPeriodInterp(bool b) {
-    m_motionsNeedProcessing = true;
     m_periodInterp = b;
 }
 
 bool MotionLibrary::periodInterp() const { return m_periodInterp; }
 
 void MotionLibrary::setPeriodCount(int size) {
-    m_motionsNeedProcessing = true;
     m_periodCount = size;
 }
 
 double MotionLibrary::periodMin() const { return m_periodMin; }
 
 void MotionLibrary::setPeriodMin(double min) {
-    m_motionsNeedProcessing = true;
     m_periodMin = min;
 }
 
 double MotionLibrary::periodMax() const { return m_periodMax; }
 
 void MotionLibrary::setPeriodMax(double max) {
-    m_motionsNeedProcessing = true;
     m_periodMax = max;
 }
 
 PeriodSpacing MotionLibrary::periodSpacing() const { return m_periodSpacing; }
 
 void MotionLibrary::setPeriodSpacing(int spacing) {
-    m_motionsNeedProcessing = true;
     m_periodSpacing = (PeriodSpacing)spacing;
 }
 
@@ -157,6 +169,20 @@ int MotionLibrary::minRequestedCount() const { return m_minRequestedCount; }
 
 int MotionLibrary::disabledCount() const { return m_disabledCount; }
 
+void MotionLibrary::setCheckpoint(const QString &fileName, int interval) {
+    m_checkpointFile = fileName;
+    m_checkpointInterval = interval;
+}
+
+void MotionLibrary::setResume(bool resume) {
+    m_resume = resume;
+}
+
+void MotionLibrary::setShard(int index, int count) {
+    m_shardIndex = index;
+    m_shardCount = count;
+}
+
 void MotionLibrary::cancel() { m_okToContinue = false; }
 
 void MotionLibrary::setSuiteCount(int count) { m_suiteCount = count; }
@@ -180,6 +206,10 @@ bool MotionLibrary::oneMotionPerStation() const {
 
 void MotionLibrary::setOneMotionPerStation(bool b) {
     m_oneMotionPerStation = b;
+
+    // Update the number of motions
+    m_trialCount = countTrials();
+    emit trialCountChanged(m_trialCount);
 }
 
 bool MotionLibrary::combineComponents() const { return m_combineComponents; }
@@ -193,6 +223,33 @@ void MotionLibrary::setCombineComponents(bool b) {
     emit trialCountChanged(m_trialCount);
 }
 
+MotionPair::Combination MotionLibrary::pairCombination() const {
+    return m_pairCombination;
+}
+
+void MotionLibrary::setPairCombination(int combination) {
+    m_pairCombination = (MotionPair::Combination)combination;
+
+    // The pairs that are already read only need their spectra combined again
+    for (AbstractMotion *motion : m_motions) {
+        if (MotionPair *pair = dynamic_cast<MotionPair *>(motion)) {
+            pair->setCombination(m_pairCombination);
+        }
+    }
+
+    reportCombinationFallbacks();
+}
+
+QString MotionLibrary::filter() const { return m_filter.expression(); }
+
+bool MotionLibrary::filterIsValid() const { return m_filter.isValid(); }
+
+QString MotionLibrary::filterError() const { return m_filter.errorString(); }
+
+void MotionLibrary::setFilter(const QString &expression) {
+    m_filter.setExpression(expression);
+}
+
 QString MotionLibrary::motionPath() const { return m_motionPath; }
 
 void MotionLibrary::setMotionPath(const QString &path) {
@@ -203,8 +260,29 @@ void MotionLibrary::setMotionPath(const QString &path) {
     m_motionsNeedProcessing = true;
     m_motionPath = path;
 
-    // Update the number of motions
-    m_motionCount = countPath(m_motionPath);
+    // The number of motions is updated once the scan is complete
+    m_motionCount = 0;
+    m_scanner->request(m_motionPath);
+}
+
+void MotionLibrary::rescanMotionPath() {
+    m_motionsNeedProcessing = true;
+    m_motionCount = 0;
+    m_scanner->rescan();
+}
+
+void MotionLibrary::reportScanError(const QString &path, const QString &error) {
+    if (path == m_motionPath) {
+        emit logText(error);
+    }
+}
+
+void MotionLibrary::setMotionCount(const QString &path, int count) {
+    if (path != m_motionPath) {
+        return;
+    }
+
+    m_motionCount = count;
     emit motionCountChanged(m_motionCount - m_disabledCount);
 
     // Update the number of motions
@@ -373,60 +451,110 @@ Qt::ItemFlags MotionLibrary::flags(const QModelIndex &index) const {
     }
 }
 
-bool MotionLibrary::interp(const QVector<double> &x, const QVector<double> &y,
-        const QVector<double> &xi, QVector<double> &yi) {
-    // Period (x) has already been checked to ensure that it is increasing
-    // Check if all of the data is bounded
-    if (std::fabs(xi.first() - x.first()) >
-            std::numeric_limits<double>::epsilon() &&
-            xi.first() < x.first()) {
-        qCritical() << QString(
-                tr("Minimum interpolated value (%1) is less than specified value (%2)")
-                .arg(xi.first())
-                .arg(x.first()));
-        return false;
+bool motionCompare(Motion *left, Motion *right) {
+    return left->name() < right->name();
+}
+
+bool MotionLibrary::deferSpectra() const {
+    return m_combineComponents && m_pairCombination != MotionPair::GeometricMean;
+}
+
+void MotionLibrary::pairComponents(QList<Motion *> &motions) {
+    // The event and station are interned, so that the components are grouped
+    // by a pair of integers
+    QHash<QString, quint32> events;
+    QHash<QString, quint32> stations;
+    QHash<quint64, int> groupIndex;
+    QVector<QList<Motion *>> groups;
+
+    for (Motion *motion : motions) {
+        const quint32 event = events.value(motion->event(), quint32(events.size()));
+        events.insert(motion->event(), event);
+        const quint32 station = stations.value(motion->station(), quint32(stations.size()));
+        stations.insert(motion->station(), station);
+
+        const quint64 key = (quint64(event) << 32) | station;
+        const int g = groupIndex.value(key, groups.size());
+        if (g == groups.size()) {
+            groupIndex.insert(key, g);
+            groups << QList<Motion *>();
+        }
+        groups[g] << motion;
     }
+    motions.clear();
+
+    // The groups keep the order of the sorted motions. The spectrum of a
+    // group is combined from its first two horizontal components, while the
+    // vertical and additional components are kept with the group.
+    QStringList unpaired;
+    int additional = 0;
+    for (const QList<Motion *> &group : groups) {
+        QList<Motion *> horizontal;
+        for (Motion *motion : group) {
+            if (!Motion::isVertical(motion->fileName())) {
+                horizontal << motion;
+            }
+        }
 
-    if (std::fabs(xi.first() - x.first()) >
-            std::numeric_limits<double>::epsilon() &&
-            xi.first() > x.first()) {
-        qCritical() << QString(tr("Maximum interpolated value (%1) is greater than "
-                    "specificed value (%2)"))
-            .arg(xi.last())
-            .arg(x.last());
-        return false;
+        if (horizontal.size() >= 2) {
+            m_motions << new MotionPair(horizontal.at(0), horizontal.at(1), group,
+                                        m_pairCombination);
+            additional += group.size() - 2;
+        } else {
+            for (Motion *motion : group) {
+                unpaired << motion->name();
+                delete motion;
+            }
+        }
     }
 
-    //
-    // Interpolate using GSL's interpolation method
-    //
-    yi.resize(xi.size());
-    gsl_interp_accel *acc = gsl_interp_accel_alloc();
-    gsl_spline *spline = gsl_spline_alloc(gsl_interp_cspline, x.size());
-    gsl_spline_init(spline, x.data(), y.data(), x.size());
+    // Report the removed motions at once
+    const auto report = [this](const QString &reason, const QStringList &names) {
+        const int shown = 20;
+        QString text = QString("[!] Removed %1 motions %2: ").arg(names.size()).arg(reason)
+                       + names.mid(0, shown).join(", ");
+        if (names.size() > shown) {
+            text += QString(", and %1 more").arg(names.size() - shown);
+        }
+        emit logText(text);
+    };
 
-    for (int i = 0; i < xi.size(); ++i) {
-        yi[i] = gsl_spline_eval(spline, xi.at(i), acc);
+    if (unpaired.size()) {
+        report("without a pair", unpaired);
+    }
+    if (additional) {
+        emit logText(QString("Grouped %1 vertical or additional components with their pairs")
+                .arg(additional));
     }
 
-    gsl_spline_free(spline);
-    gsl_interp_accel_free(acc);
-
-    return true;
+    reportCombinationFallbacks();
 }
 
-bool isAt2Vertical(const QString &fileName) {
-    QStringList endings = {"-UP.AT2", "UD.AT2", "-V.AT2", "DN.AT2", "DWN.AT2"};
-    for (auto e : endings) {
-        if (fileName.endsWith(e, Qt::CaseInsensitive)) {
-            return true;
+void MotionLibrary::reportCombinationFallbacks() {
+    if (m_pairCombination == MotionPair::GeometricMean) {
+        return;
+    }
+
+    QStringList names;
+    for (const AbstractMotion *motion : m_motions) {
+        const MotionPair *pair = dynamic_cast<const MotionPair *>(motion);
+        if (pair && pair->effectiveCombination() != pair->combination()) {
+            names << pair->name();
         }
     }
-    return false;
-}
 
-bool motionCompare(Motion *left, Motion *right) {
-    return left->name() < right->name();
+    if (names.isEmpty()) {
+        return;
+    }
+
+    const int shown = 20;
+    QString text = QString("[!] Using the geometric mean of %1 pairs without RotD spectra: ")
+                           .arg(names.size())
+                   + names.mid(0, shown).join(", ");
+    if (names.size() > shown) {
+        text += QString(", and %1 more").arg(names.size() - shown);
+    }
+    emit logText(text);
 }
 
 bool MotionLibrary::readMotions() {
@@ -453,52 +581,42 @@ bool MotionLibrary::readMotions() {
                 m_period[i] = pow(10, logMin + delta * i);
             }
         }
-
-        if (interp(m_inputPeriod, m_inputSa, m_period, m_targetSa) == false) {
-            return false;
-        }
-
-        if (interp(m_inputPeriod, m_inputLnStd, m_period, m_targetLnStd) == false) {
-            return false;
-        }
     } else {
-        m_period = m_inputPeriod;
-        m_targetSa = m_inputSa;
-        m_targetLnStd = m_inputLnStd;
+        m_period = m_target.inputPeriod();
+        // The oscillators need a positive period, a row at zero period (the
+        // PGA) is only used by the interpolation of the target
+        if (m_period.size() && m_period.first() <= 0) {
+            m_period.removeFirst();
+        }
     }
 
-    // Compute the target in log space along with the plus and minus one standard
-    // deviation
-    m_targetLnSa.resize(m_targetSa.size());
-    m_targetSaPlusStd.resize(m_targetSa.size());
-    m_targetSaMinusStd.resize(m_targetSa.size());
-
-    for (int i = 0; i < m_targetSa.size(); ++i) {
-        m_targetLnSa[i] = log(m_targetSa.at(i));
-        m_targetSaPlusStd[i] = exp(m_targetLnSa.at(i) + m_targetLnStd.at(i));
-        m_targetSaMinusStd[i] = exp(m_targetLnSa.at(i) - m_targetLnStd.at(i));
+    if (m_target.prepare(m_period) == false) {
+        return false;
     }
 
-
-    // Check that the periods lengths agree if not reprocess
-    if (m_motions.size() > 0) {
-        const QVector<double> &period = m_motions.first()->period();
-        if (period.size() != m_period.size()) {
-            m_motionsNeedProcessing = true;
-        } else {
-            for (int i = 0; i < m_period.size(); ++i) {
-                if (period.at(i) != m_period.at(i)) {
-                    m_motionsNeedProcessing = true;
-                    break;
-                }
+    // The oscillators are shared by all of the motions in the library.  If
+    // they differ from the previously processed motions then reprocess.
+    SpectralContextPtr context(new SpectralContext(m_period, m_damping / 100.));
+
+    if (m_context.isNull()) {
+        m_motionsNeedProcessing = true;
+    } else if (!m_motionsNeedProcessing && !m_context->isEquivalent(*context)) {
+        if (m_context->canResampleTo(*context)) {
+            // Only the periods changed, so interpolate the master spectra
+            emit logText("Interpolating the response spectra of the motions");
+            m_context = context;
+            for (AbstractMotion *motion : m_motions) {
+                motion->setContext(m_context);
             }
+            reportCombinationFallbacks();
+        } else {
+            m_motionsNeedProcessing = true;
         }
     }
 
-    Motion::setPeriod(m_period);
-    Motion::setDamping(m_damping / 100.);
-
     if (m_motionsNeedProcessing) {
+        m_context = context;
+
         // Delete previously loaded motions
         while (m_motions.size()) {
             delete m_motions.takeFirst();
@@ -508,50 +626,11 @@ bool MotionLibrary::readMotions() {
 
         QList<Motion *> motions;
 
-        // Read the motion files
-        QStringList nameFilters;
-        nameFilters << "*.AT2"
-            << "*.at2";
-
-        QDirIterator it(m_motionPath, nameFilters,
-                QDir::AllDirs | QDir::Files | QDir::Readable,
-                QDirIterator::Subdirectories);
-
-        // Keep track of the percent
-        int nextPercent = 1;
-        int percent = 0;
-        emit percentChanged(percent);
-
-        while (it.hasNext()) {
-            QString filePath = it.next();
-            if (filePath.endsWith(".AT2", Qt::CaseInsensitive)) {
-                if (isAt2Vertical(filePath)) {
-                    emit logText("Skipping (vertical): " +
-                            QDir::toNativeSeparators(filePath));
-                    continue;
-                }
-                // Update the log
-                QApplication::processEvents();
-                auto m = new Motion(filePath);
-                if (m->processFile()) {
-                    emit logText("Loaded: " + QDir::toNativeSeparators(filePath));
-                    motions << m;
-                } else {
-                    emit logText("!! Error reading: " +
-                            QDir::toNativeSeparators(filePath));
-                }
-            }
-
-            if (m_okToContinue == false) {
-                return false;
-            }
-
-            percent = int(100 * motions.size() / m_motionCount);
-            if (percent >= nextPercent) {
-                // Emit a new percent complete is avaiable
-                emit percentChanged(percent);
-                nextPercent = percent + 1;
-            }
+        const bool ok = PackedLibrary::isPacked(m_motionPath)
+            ? readPacked(motions) : readFiles(motions);
+        if (ok == false) {
+            qDeleteAll(motions);
+            return false;
         }
 
         // Sort the motions by name
@@ -559,30 +638,7 @@ bool MotionLibrary::readMotions() {
 
         if (m_combineComponents) {
             // Combine motions from the same event and station
-            while (motions.size()) {
-                Motion *motionA = motions.takeFirst();
-                Motion *motionB = 0;
-
-                for (int i = 0; i < motions.size(); ++i) {
-                    if (MotionPair::isAPair(motionA, motions.at(i))) {
-                        motionB = motions.at(i);
-                        break;
-                    }
-                }
-
-                if (motionB) {
-                    m_motions << new MotionPair(motionA, motionB);
-                    motions.removeOne(motionB);
-                } else {
-                    // Remove the motion
-                    emit logText("[!] Removing: " + motionA->name() + " no pair found.");
-                    delete motionA;
-                }
-
-                if (m_okToContinue == false) {
-                    return false;
-                }
-            }
+            pairComponents(motions);
         } else {
             while (motions.size()) {
                 m_motions << motions.takeFirst();
@@ -603,55 +659,212 @@ bool MotionLibrary::readMotions() {
     return true;
 }
 
-int MotionLibrary::countPath(const QString &path) {
-    int count = 0;
-
-    // Read the motion files
-    QStringList nameFilters;
-    nameFilters << "*.AT2"
-        << "*.at2";
+bool MotionLibrary::readFiles(QList<Motion *> &motions) {
+    // Use the count of the scan if it is complete
+    m_motionCount = m_scanner->count(m_motionPath);
 
-    QDirIterator it(path, nameFilters,
+    // Read the motion files of all of the registered formats
+    QDirIterator it(m_motionPath, RecordReader::allNameFilters(),
             QDir::AllDirs | QDir::Files | QDir::Readable,
             QDirIterator::Subdirectories);
 
+    // Keep track of the percent
+    int nextPercent = 1;
+    int percent = 0;
+    emit percentChanged(percent);
+
     while (it.hasNext()) {
         QString filePath = it.next();
-        if (!isAt2Vertical(filePath)) {
-            ++count;
+        if (it.fileInfo().isFile()) {
+            // Vertical components are only read to be grouped with the
+            // horizontal components of their station
+            if (!m_combineComponents && Motion::isVertical(filePath)) {
+                emit logText("Skipping (vertical): " +
+                        QDir::toNativeSeparators(filePath));
+                continue;
+            }
+            // Update the log
+            QApplication::processEvents();
+            auto m = new Motion(filePath, m_context);
+            if (m->processFile(!deferSpectra())) {
+                emit logText("Loaded: " + QDir::toNativeSeparators(filePath));
+                motions << m;
+            } else {
+                emit logText("!! Error reading: " +
+                        QDir::toNativeSeparators(filePath));
+                delete m;
+            }
+        }
+
+        if (m_okToContinue == false) {
+            return false;
+        }
+
+        // Vertical components are read but not counted
+        percent = qMin(100, int(100 * motions.size() / qMax(1, m_motionCount)));
+        if (percent >= nextPercent) {
+            // Emit a new percent complete is avaiable
+            emit percentChanged(percent);
+            nextPercent = percent + 1;
+        }
+    }
+
+    return true;
+}
+
+bool MotionLibrary::readPacked(QList<Motion *> &motions) {
+    PackedLibrary library;
+    if (library.open(m_motionPath) == false) {
+        qCritical() << library.errorString();
+        return false;
+    }
+
+    int nextPercent = 1;
+    int percent = 0;
+    emit percentChanged(percent);
+
+    for (int i = 0; i < library.count(); ++i) {
+        const QString filePath = m_motionPath + "/" + library.record(i).fileName;
+        if (!m_combineComponents && Motion::isVertical(filePath)) {
+            continue;
+        }
+
+        QApplication::processEvents();
+        auto m = new Motion(filePath, m_context);
+        if (m->processPacked(library, i, !deferSpectra())) {
+            emit logText("Loaded: " + QDir::toNativeSeparators(filePath));
+            motions << m;
+        } else {
+            emit logText("!! Error reading: " + QDir::toNativeSeparators(filePath));
+            delete m;
+        }
+
+        if (m_okToContinue == false) {
+            return false;
+        }
+
+        percent = int(100 * (i + 1) / library.count());
+        if (percent >= nextPercent) {
+            emit percentChanged(percent);
+            nextPercent = percent + 1;
         }
     }
-    return count;
+
+    return true;
 }
 
-double MotionLibrary::factorial(const int n) {
-    return exp(n * log(n) - n + (log(n * (1 + 4 * n * (1 + 2 * n)))) / 6 +
-            log(M_PI) / 2);
+bool MotionLibrary::pack(const QString &fileName, bool singlePrecision) {
+    if (PackedLibrary::isPacked(m_motionPath)) {
+        qCritical("The motion library is already packed.");
+        return false;
+    }
+
+    PackedLibrary library;
+    if (library.create(fileName, singlePrecision) == false) {
+        return false;
+    }
+
+    QDirIterator it(m_motionPath, RecordReader::allNameFilters(),
+            QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+    const QDir dir(m_motionPath);
+
+    int count = 0;
+    while (it.hasNext()) {
+        const QString filePath = it.next();
+        // The records are packed as read, without processing. Vertical
+        // components are packed as well, so that they can be grouped.
+        RecordReader::Record motion;
+        if (RecordReader::readFile(filePath, motion) == false
+            || motion.dt <= 0 || motion.acc.isEmpty()) {
+            emit logText("!! Error reading: " + QDir::toNativeSeparators(filePath));
+            continue;
+        }
+
+        PackedLibrary::Record record;
+        record.fileName = dir.relativeFilePath(filePath);
+        record.event = motion.event;
+        record.station = motion.station;
+        record.component = motion.component;
+        record.details = motion.details;
+        record.dt = motion.dt;
+
+        if (library.append(record, motion.acc) == false) {
+            return false;
+        }
+        ++count;
+    }
+
+    if (library.finish() == false) {
+        return false;
+    }
+
+    emit logText(QString("Packed %1 motions into %2")
+            .arg(count).arg(QDir::toNativeSeparators(fileName)));
+    return true;
+}
+
+double MotionLibrary::countSteps(int candidateCount) const {
+    // Motions checked while growing each seed to the suite size
+    double steps = 0;
+    for (int size = m_seedSize; size < m_suiteSize; ++size) {
+        steps += candidateCount - size;
+    }
+    return qMax(1., steps);
+}
+
+void MotionLibrary::defineSeeds(const QList<AbstractMotion *> &candidates,
+                                QVector<int> &groups, SeedSpace &seedSpace) const {
+    // Motions from the same station cannot be combined in a seed if only one
+    // motion per station is permitted
+    groups.resize(candidates.size());
+    QHash<QString, int> stations;
+    for (int i = 0; i < candidates.size(); ++i) {
+        if (m_oneMotionPerStation) {
+            const QString &station = candidates.at(i)->station();
+            groups[i] = stations.value(station, stations.size());
+            stations.insert(station, groups.at(i));
+        } else {
+            groups[i] = i;
+        }
+    }
+
+    // Required motions are not placed in the seeds, they are picked up while
+    // growing the seeds and the suites without them are rejected
+    seedSpace.reset(groups, m_seedSize);
 }
 
 double MotionLibrary::countTrials() {
     if (m_seedSize > m_suiteSize || m_suiteSize > m_motionCount) {
         return 0;
+    } else if (m_motionsNeedProcessing == false && m_motions.isEmpty() == false) {
+        // Once the motions are read, the seeds that are searched are counted
+        // exactly with the flags, the filter, and the stations of the motions
+        QList<AbstractMotion *> requiredMotions;
+        QList<AbstractMotion *> candidates;
+        screenMotions(candidates, requiredMotions, false);
+
+        QVector<int> groups;
+        SeedSpace seedSpace;
+        defineSeeds(candidates, groups, seedSpace);
+
+        return seedSpace.approxCount() * countSteps(candidates.size());
     } else {
-        int motionCount =
+        // The stations and the filter are only known once the motions are
+        // read, so the seeds are the combinations of the enabled motions.
+        const int motionCount =
             (m_motionCount - m_disabledCount) / (m_combineComponents ? 2 : 1);
 
-        // Count the number of seed motions
-        m_seedCount = factorial(motionCount) /
-            (factorial(m_seedSize) * factorial(motionCount - m_seedSize));
-
-        // Count the number of iterative trials
-        unsigned long iterCmb = 0;
-        for (int i = 0; i < m_suiteSize; ++i) {
-            iterCmb += motionCount - i;
-        }
-
-        if (iterCmb == 0) {
-            iterCmb = 1;
+        bool overflow;
+        const quint64 seedCount = SeedSpace::binomial(motionCount, m_seedSize, &overflow);
+        if (overflow) {
+            // Approximate the count in log space
+            return exp(lgamma(motionCount + 1.) - lgamma(m_seedSize + 1.)
+                       - lgamma(motionCount - m_seedSize + 1.))
+                   * countSteps(motionCount);
         }
 
         // Return the product of the iterative portion and the seed portion
-        return m_seedCount * iterCmb;
+        return double(seedCount) * countSteps(motionCount);
     }
 }
 
@@ -669,12 +882,14 @@ void MotionLibrary::save() {
 
     settings.setValue("library/oneMotionPerStation", m_oneMotionPerStation);
     settings.setValue("library/combineComponents", m_combineComponents);
+    settings.setValue("library/pairCombination", m_pairCombination);
 
     settings.setValue("library/motionPath", m_motionPath);
     settings.setValue("library/seedSize", m_seedSize);
     settings.setValue("library/suiteSize", m_suiteSize);
     settings.setValue("library/suiteCount", m_suiteCount);
     settings.setValue("library/minRequestedCount", m_minRequestedCount);
+    settings.setValue("library/filter", m_filter.expression());
 }
 
 bool MotionLibrary::compute() {
@@ -694,8 +909,67 @@ bool MotionLibrary::compute() {
         return false;
     }
 
+    return scaleSuites(m_suites);
+}
+
+bool MotionLibrary::computeBatch(const QList<TargetSpectrum *> &targets,
+        QVector<QList<MotionSuite *>> &suites, const QStringList &mergeFiles) {
+    if (targets.isEmpty()) {
+        qCritical("No target specified");
+        return false;
+    }
+
+    // The first target is used to define the periods of the library
+    m_target = *targets.first();
+
+    // Read each of the motions
+    if (readMotions() == false) {
+        return false;
+    }
+
+    QList<const TargetSpectrum *> preparedTargets;
+    for (TargetSpectrum *target : targets) {
+        if (target->isValid() == false || target->prepare(m_period) == false) {
+            emit logText("!! Invalid target: " + target->name());
+            return false;
+        }
+        preparedTargets << target;
+    }
+
+    if (mergeFiles.isEmpty()) {
+        // Select the suites
+        emit logText(QString("Selecting suites for %1 targets").arg(targets.size()));
+        if (selectSuites(preparedTargets, suites) == false) {
+            return false;
+        }
+
+        // The suites of a shard are only scaled once they are merged
+        if (m_shardCount > 1) {
+            return true;
+        }
+    } else if (mergeSuites(preparedTargets, mergeFiles, suites) == false) {
+        return false;
+    }
+
+    for (int i = 0; i < targets.size(); ++i) {
+        emit logText("Target: " + targets.at(i)->name());
+
+        if (suites.at(i).size() == 0) {
+            emit logText("No suites found!");
+            continue;
+        }
+
+        if (scaleSuites(suites[i]) == false) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool MotionLibrary::scaleSuites(QList<MotionSuite *> &suites) {
     // Sort the suites from smallest median mse to largest
-    std::sort(m_suites.begin(), m_suites.end(), lessThan);
+    std::sort(suites.begin(), suites.end(), lessThan);
 
     // Scale the selected suites
     if (m_okToContinue == false) {
@@ -704,43 +978,24 @@ bool MotionLibrary::compute() {
 
     emit logText("Scaling suites");
 
-    for (int i = 0; i < m_suites.size(); i++) {
+    for (int i = 0; i < suites.size(); i++) {
         // Scale the suite
-        m_suites.at(i)->computeScalars();
+        suites.at(i)->computeScalars();
         // Update the log with the information
         emit logText(QString("[%1/%2] %3")
                 .arg(i + 1)
-                .arg(m_suites.size())
-                .arg(m_suites.at(i)->errorText()));
+                .arg(suites.size())
+                .arg(suites.at(i)->errorText()));
     }
 
     return true;
 }
 
 bool MotionLibrary::isInputValid() {
-    if (m_inputPeriod.size() == 0) {
-        qCritical("No target specified");
+    if (m_target.isValid() == false) {
         return false;
     }
 
-    // Period of the target spectrum must be increasing
-    for (int i = 0; i < m_inputPeriod.size() - 1; ++i) {
-        if (m_inputPeriod.at(i) > m_inputPeriod.at(i + 1)) {
-            qCritical("The period of the input target spectrum must be an "
-                    "increasing. (T_1 < T_2)");
-            return false;
-        }
-    }
-
-    // Standard deviation must be greater than zero
-    for (int i = 0; i < m_inputLnStd.size() - 1; ++i) {
-        if (m_inputLnStd.at(i) < 0) {
-            qCritical("The standard deviation of the input target spectrum must be "
-                    "greater than zero.");
-            return false;
-        }
-    }
-
     // Check the interpolation conditions
 
     if (m_periodInterp) {
@@ -760,19 +1015,19 @@ bool MotionLibrary::isInputValid() {
             return false;
         }
 
-        if (m_periodSpacing == Log && m_inputPeriod.first() <= 0) {
+        if (m_periodSpacing == Log && m_target.inputPeriod().first() <= 0) {
             qCritical("The minimum period of the target spectrum must be larger than "
                     "zero with log spacing.");
             return false;
         }
 
-        if (m_inputPeriod.first() > m_periodMin) {
+        if (m_target.inputPeriod().first() > m_periodMin) {
             qCritical("Minimum interpolated period is less than minimum period of "
                     "the target spectrum.");
             return false;
         }
 
-        if (m_inputPeriod.last() < m_periodMax) {
+        if (m_target.inputPeriod().last() < m_periodMax) {
             qCritical("Maximum interpolated period is greater than maximum period of "
                     "the target spectrum.");
             return false;
@@ -794,6 +1049,11 @@ bool MotionLibrary::isInputValid() {
         return false;
     }
 
+    if (m_filter.isValid() == false) {
+        qCritical() << "The motion filter is not valid." << m_filter.errorString();
+        return false;
+    }
+
     return true;
 }
 
@@ -803,102 +1063,251 @@ bool MotionLibrary::selectSuites() {
         delete m_suites.takeFirst();
     }
 
-    // Initialize the seed to have values from 0 to n-1
-    m_seed.resize(m_seedSize);
-    for (int i = 0; i < m_seed.size(); i++) {
-        m_seed[i] = i;
-    }
+    QVector<QList<MotionSuite *>> suites;
+    const bool success = selectSuites(
+            QList<const TargetSpectrum *>() << &m_target, suites);
+    m_suites = suites.first();
+
+    return success;
+}
+
+bool MotionLibrary::selectSuites(const QList<const TargetSpectrum *> &targets,
+        QVector<QList<MotionSuite *>> &suites) {
+    const int targetCount = targets.size();
+
+    suites.fill(QList<MotionSuite *>(), targetCount);
 
-    // Create a list of required motions
     QList<AbstractMotion *> requiredMotions;
-    for (AbstractMotion *am : m_motions) {
-        if (am->flag() == AbstractMotion::Required) {
-            requiredMotions << am;
+    QList<AbstractMotion *> candidates;
+    screenMotions(candidates, requiredMotions);
+
+    // The best suites of each target are kept as candidate indices and the
+    // MotionSuites are only created once the search stops
+    QVector<TrialPool> pools(targetCount);
+    for (TrialPool &pool : pools) {
+        pool.reset(m_suiteCount, m_suiteSize);
+    }
+
+    if (requiredMotions.size() > m_suiteSize) {
+        qCritical("There are more required motions than motions in the suite.");
+        return false;
+    }
+
+    QVector<int> groups;
+    SeedSpace seedSpace;
+    defineSeeds(candidates, groups, seedSpace);
+    if (seedSpace.isValid() == false) {
+        qCritical("Not enough motions for the seed.");
+        return false;
+    }
+
+    // Update the number of trials with the candidates
+    m_trialCount = seedSpace.approxCount() * countSteps(candidates.size());
+    emit trialCountChanged(m_trialCount);
+
+    seedSpace.first(m_seed);
+
+    // The shards of a run share the fingerprint, so that they can be merged
+    QJsonObject configuration = runConfiguration(targets, candidates);
+    const QString fingerprint = runFingerprint(configuration, targets, candidates);
+    configuration["shardIndex"] = m_shardIndex;
+    configuration["shardCount"] = m_shardCount;
+
+    // Number of seeds evaluated, which is also the rank of the next seed
+    quint64 count = 0;
+    bool finished = false;
+
+    // Limit the seeds to the range of the shard
+    quint64 shardBegin = 0;
+    quint64 shardEnd = 0;
+    if (m_shardCount > 1) {
+        if (seedSpace.isOverflow()) {
+            qCritical("Too many seeds to be divided into shards.");
+            return false;
+        }
+
+        seedSpace.chunk(m_shardIndex, m_shardCount, &shardBegin, &shardEnd);
+        emit logText(QString("Shard %1 of %2: seeds %3 to %4 of %5")
+                .arg(m_shardIndex + 1).arg(m_shardCount)
+                .arg(shardBegin).arg(shardEnd).arg(seedSpace.count()));
+
+        count = shardBegin;
+        if (shardBegin < shardEnd) {
+            seedSpace.unrank(shardBegin, m_seed);
+        } else {
+            finished = true;
+        }
+    }
+
+    // Continue from the checkpoint of a previous run
+    if (m_resume && QFile::exists(m_checkpointFile)) {
+        SelectionCheckpoint checkpoint;
+        if (restoreCheckpoint(m_checkpointFile, fingerprint, targets, candidates, pools,
+                              checkpoint) == false) {
+            return false;
+        }
+
+        if (checkpoint.configuration.value("shardIndex").toInt() != m_shardIndex
+            || checkpoint.configuration.value("shardCount").toInt() != m_shardCount) {
+            qCritical() << "The checkpoint is of a different shard:" << m_checkpointFile;
+            return false;
+        }
+
+        if (checkpoint.finished == false) {
+            if (seedSpace.contains(checkpoint.seed) == false) {
+                qCritical() << "Corrupt checkpoint:" << m_checkpointFile;
+                return false;
+            }
+            m_seed = checkpoint.seed;
+        }
+        count = checkpoint.count;
+        finished = checkpoint.finished;
+
+        emit logText(QString("Resumed from the checkpoint after %1 seeds").arg(count));
+    }
+
+    // Spectra of the candidates, and the candidate indices of the requested
+    // and required motions used to check the suites
+    QVector<const double *> lnSa(candidates.size());
+    QVector<bool> requested(candidates.size());
+    QVector<int> required;
+    for (int i = 0; i < candidates.size(); ++i) {
+        lnSa[i] = candidates.at(i)->lnSa().constData();
+        requested[i] = (candidates.at(i)->flag() == AbstractMotion::Requested);
+        if (requiredMotions.contains(candidates.at(i))) {
+            required << i;
+        }
+    }
+
+    // Check the suite size, the number of requested motions, and that all of
+    // the required motions are present. The motions are unique to each
+    // station, as the seeds and the added motions are checked by group.
+    const auto isTrialValid = [&](const TrialSuite &trial) {
+        if (trial.size() != m_suiteSize) {
+            return false;
+        }
+
+        const int *indices = trial.indices();
+        int count = 0;
+        for (int j = 0; j < trial.size(); ++j) {
+            if (requested.at(indices[j])) {
+                ++count;
+            }
+        }
+        if (count < m_minRequestedCount) {
+            return false;
+        }
+
+        for (int i : required) {
+            if (std::find(indices, indices + trial.size(), i) == indices + trial.size()) {
+                return false;
+            }
         }
+        return true;
+    };
+
+    // Suite being built for each target, along with the smallest error found
+    // while adding a motion and the index of that motion. The trials are
+    // allocated once and cleared for each seed.
+    QVector<TrialSuite> trials(targetCount);
+    for (int t = 0; t < targetCount; ++t) {
+        trials[t].reset(m_suiteSize, targets.at(t)->lnSa());
     }
+    QVector<double> minError(targetCount);
+    QVector<int> minIdx(targetCount);
+    QVector<bool> growing(targetCount);
 
     // Keep track of the percent
-    int nextPercent = 1;
-    int percent = 0;
+    const double seedCount =
+        (m_shardCount > 1) ? double(shardEnd - shardBegin) : seedSpace.approxCount();
+    int percent = (seedCount > 0) ? int(100. * (count - shardBegin) / seedCount) : 100;
+    int nextPercent = percent + 1;
     emit percentChanged(percent);
-    unsigned long count = 0;
     // Keep track of time to estimate estimated time of completion
+    const quint64 startCount = count;
     QElapsedTimer timer;
     QTime now;
     timer.start();
-
-    do {
-        // Check if any of the motions in the seed are disabled
-        bool badSeed = false;
-        for (int i = 0; i < m_seed.size(); i++) {
-            if (m_motions.at(m_seed.at(i))->flag() == AbstractMotion::Disabled) {
-                badSeed = true;
-                break;
-            }
-        }
-        if (badSeed) {
-            continue;
+    // Time since the last checkpoint
+    QElapsedTimer checkpointTimer;
+    checkpointTimer.start();
+
+    bool more = !finished;
+    while (more) {
+        // Save the checkpoint before the seed is evaluated
+        if (m_checkpointFile.isEmpty() == false
+            && checkpointTimer.hasExpired(1000 * qint64(m_checkpointInterval))) {
+            saveCheckpoint(fingerprint, configuration, pools, count, false);
+            checkpointTimer.restart();
         }
 
-        // Create a MotionSuite and add the seed motions
-        MotionSuite *ms = new MotionSuite(m_period, m_targetLnSa, m_targetLnStd);
-        for (int i = 0; i < m_seed.size(); i++) {
-            ms->addMotion(m_motions.at(m_seed.at(i)));
+        // Start the trial of each target with the seed motions
+        for (int t = 0; t < targetCount; ++t) {
+            trials[t].clear();
+            for (int i = 0; i < m_seed.size(); i++) {
+                trials[t].addMotion(m_seed.at(i), lnSa.at(m_seed.at(i)));
+            }
         }
+        growing.fill(true);
 
         // Add the one motion that lowers the error the most until the
-        // appropriate suite size has been achieved
+        // appropriate suite size has been achieved. The suites of all targets
+        // grow together, so each motion is checked against every target while
+        // its spectrum is still in the cache.
         bool motionWasAdded = true;
-        while (motionWasAdded && ms->motions().size() < m_suiteSize) {
+        for (int size = m_seed.size(); motionWasAdded && size < m_suiteSize; ++size) {
             if (m_okToContinue == false) {
+                saveCheckpoint(fingerprint, configuration, pools, count, false);
+                createSuites(targets, candidates, pools, suites);
                 return false;
             }
 
-            // Assume no motion is added
-            motionWasAdded = false;
-
             // Initialized the error
-            double minError = 100;
-            int minIdx = -1;
-            for (int i = 0; i < m_motions.size(); i++) {
-                // Skip if the motion is not valid -- not previously added
-                if (ms->isMotionValid(m_oneMotionPerStation, m_motions.at(i)) ==
-                        false) {
-                    continue;
-                }
+            minError.fill(100);
+            minIdx.fill(-1);
+            for (int i = 0; i < candidates.size(); i++) {
+                for (int t = 0; t < targetCount; ++t) {
+                    // Skip if the motion is not valid -- not previously added
+                    if (growing.at(t) == false
+                        || trials.at(t).isMotionValid(i, groups) == false) {
+                        continue;
+                    }
 
-                // Compute the error with the new motion
-                double error = ms->checkMotion(m_motions.at(i));
+                    // Compute the error with the new motion
+                    const double error = trials.at(t).checkMotion(lnSa.at(i));
 
-                // If the error is the smallest value, save the error and the motion
-                // index
-                if (error < minError) {
-                    minError = error;
-                    minIdx = i;
+                    // If the error is the smallest value, save the error and
+                    // the motion index
+                    if (error < minError.at(t)) {
+                        minError[t] = error;
+                        minIdx[t] = i;
+                    }
                 }
             }
 
-            if (minIdx != -1) {
-                // Add the motion that results in the lowest error to the suite
-                ms->addMotion(m_motions.at(minIdx));
-                motionWasAdded = true;
-                // qDebug("Added motion: %i",minIdx);
-            } else {
-                motionWasAdded = false;
+            // Add the motion that results in the lowest error to the suite
+            motionWasAdded = false;
+            for (int t = 0; t < targetCount; ++t) {
+                if (minIdx.at(t) != -1) {
+                    trials[t].addMotion(minIdx.at(t), lnSa.at(minIdx.at(t)));
+                    motionWasAdded = true;
+                } else {
+                    growing[t] = false;
+                }
             }
         }
+
         // Add the suite to the saved suites. If the seed size is the same as
         // the suite size check the suite before adding it
-        if (ms->isValid(m_suiteSize, m_minRequestedCount, requiredMotions,
-                    m_oneMotionPerStation)) {
-            addSuite(ms);
-        } else {
-            delete ms;
+        for (int t = 0; t < targetCount; ++t) {
+            if (isTrialValid(trials.at(t))) {
+                pools[t].add(trials.at(t));
+            }
         }
 
         // Print the status
         count++;
-        percent = int(100 * count / m_seedCount);
+        percent = int(100. * (count - shardBegin) / seedCount);
         if (percent >= nextPercent) {
             // Emit a new percent complete is avaiable
             emit percentChanged(percent);
@@ -906,7 +1315,8 @@ bool MotionLibrary::selectSuites() {
             now = QTime::currentTime();
             // Emit that a new time is available
             emit timeChanged(
-                    now.addMSecs(timer.elapsed() * int(ceil((100 - percent) / percent)))
+                    now.addMSecs(qint64(timer.elapsed() * (seedCount - (count - shardBegin))
+                                       / (count - startCount)))
                     .toString(Qt::LocalDate));
             // Have the application process the events
             QApplication::processEvents();
@@ -914,87 +1324,259 @@ bool MotionLibrary::selectSuites() {
             nextPercent = percent + 1;
         }
 
+        more = (m_shardCount <= 1 || count < shardEnd) && seedSpace.next(m_seed);
+
         if (m_okToContinue == false) {
             // Stop if the user requests it.
+            saveCheckpoint(fingerprint, configuration, pools, count, !more);
+            createSuites(targets, candidates, pools, suites);
             return false;
         }
-    } while (nextSeed());
+    }
+
+    saveCheckpoint(fingerprint, configuration, pools, count, true);
+    createSuites(targets, candidates, pools, suites);
 
     emit percentChanged(100);
 
     return true;
 }
 
-void MotionLibrary::addSuite(MotionSuite *suite) {
-    if (suite->motions().size() != m_suiteSize) {
-        qDebug("Suite not saved -- not enough motions.  Only %i of %i",
-                suite->motions().size(), m_suiteSize);
-        delete suite;
-        return;
+void MotionLibrary::createSuites(const QList<const TargetSpectrum *> &targets,
+                                 const QList<AbstractMotion *> &candidates,
+                                 const QVector<TrialPool> &pools,
+                                 QVector<QList<MotionSuite *>> &suites) {
+    for (int t = 0; t < targets.size(); ++t) {
+        for (int i = 0; i < pools.at(t).size(); ++i) {
+            MotionSuite *suite =
+                new MotionSuite(m_period, targets.at(t)->lnSa(), targets.at(t)->lnStd());
+            // The motions are added in the order of the trial, so the
+            // average is the same as found during the search
+            for (int j : pools.at(t).indices(i)) {
+                suite->addMotion(candidates.at(j));
+            }
+            suites[t] << suite;
+        }
     }
+}
 
-    // Compare the new suite to the previously saved suites.  If the new suite
-    // is exactly the same as a previously saved suite, then delete the new
-    // suite.
-    for (int i = 0; i < m_suites.size(); ++i) {
-        int repeats = 0;
-        for (int j = 0; j < m_suiteSize; ++j) {
-            for (int k = 0; k < m_suiteSize; ++k) {
-                if (m_suites.at(i)->motions().at(j) == suite->motions().at(k)) {
-                    ++repeats;
-                }
-            }
-            // If all motions are repeated with another suite, delete the current
-            // suite.
-            if (repeats == m_suiteSize) {
-                delete suite;
-                return;
-            }
+QJsonObject MotionLibrary::runConfiguration(const QList<const TargetSpectrum *> &targets,
+                                            const QList<AbstractMotion *> &candidates) const {
+    QJsonArray names;
+    for (const TargetSpectrum *target : targets) {
+        names << target->name();
+    }
+
+    QJsonObject config;
+    config["motionPath"] = m_motionPath;
+    config["filter"] = m_filter.expression();
+    config["candidateCount"] = candidates.size();
+    config["damping"] = m_damping;
+    config["periodCount"] = m_period.size();
+    config["seedSize"] = m_seedSize;
+    config["suiteSize"] = m_suiteSize;
+    config["suiteCount"] = m_suiteCount;
+    config["minRequestedCount"] = m_minRequestedCount;
+    config["oneMotionPerStation"] = m_oneMotionPerStation;
+    config["combineComponents"] = m_combineComponents;
+    config["pairCombination"] = int(m_pairCombination);
+    config["targets"] = names;
+
+    // Suites without the required motions are rejected
+    QJsonArray required;
+    for (int i = 0; i < candidates.size(); ++i) {
+        if (candidates.at(i)->flag() == AbstractMotion::Required) {
+            required << i;
         }
     }
+    config["required"] = required;
 
-    //
-    // If the requested number of suites has not been met add the suite
-    //
-    if (m_suites.size() < m_suiteCount) {
-        m_suites.push_back(suite);
-    } else if (suite->medianError() < m_worstError) {
-        // Remove the worst set
-        delete m_suites.at(m_worstLoc);
-        // Replace the suite with the worst error with the new suite
-        m_suites[m_worstLoc] = suite;
-    } else {
-        delete suite;
+    return config;
+}
+
+QString MotionLibrary::runFingerprint(const QJsonObject &configuration,
+                                      const QList<const TargetSpectrum *> &targets,
+                                      const QList<AbstractMotion *> &candidates) const {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QJsonDocument(configuration).toJson(QJsonDocument::Compact));
+
+    // The suites are saved as indices, so the candidates need to be the same
+    for (const AbstractMotion *motion : candidates) {
+        hash.addData(motion->name().toUtf8());
+    }
+
+    const auto addValues = [&hash](const QVector<double> &values) {
+        hash.addData(reinterpret_cast<const char *>(values.constData()),
+                     values.size() * int(sizeof(double)));
+    };
+
+    addValues(m_period);
+    for (const TargetSpectrum *target : targets) {
+        addValues(target->lnSa());
+        addValues(target->lnStd());
+    }
+
+    return hash.result().toHex();
+}
+
+void MotionLibrary::saveCheckpoint(const QString &fingerprint, const QJsonObject &configuration,
+                                   const QVector<TrialPool> &pools,
+                                   quint64 count, bool finished) const {
+    if (m_checkpointFile.isEmpty()) {
         return;
     }
 
-    // Update the location of the worst error
-    m_worstError = m_suites.first()->medianError();
-    m_worstLoc = 0;
-    for (int i = 1; i < m_suites.size(); i++) {
-        if (m_suites.at(i)->medianError() > m_worstError) {
-            m_worstError = m_suites.at(i)->medianError();
-            m_worstLoc = i;
+    SelectionCheckpoint checkpoint;
+    checkpoint.fingerprint = fingerprint;
+    checkpoint.configuration = configuration;
+    checkpoint.count = count;
+    checkpoint.finished = finished;
+    checkpoint.seed = m_seed;
+
+    for (const TrialPool &pool : pools) {
+        QList<QVector<int>> indices;
+        for (int i = 0; i < pool.size(); ++i) {
+            indices << pool.indices(i);
         }
+        checkpoint.suites << indices;
     }
+
+    // A failed checkpoint does not stop the selection
+    checkpoint.save(m_checkpointFile);
 }
 
-bool MotionLibrary::nextSeed() {
-    if (m_seed[0] == (m_motions.size() - m_seed.size())) {
+bool MotionLibrary::restoreCheckpoint(const QString &fileName, const QString &fingerprint,
+                                      const QList<const TargetSpectrum *> &targets,
+                                      const QList<AbstractMotion *> &candidates,
+                                      QVector<TrialPool> &pools,
+                                      SelectionCheckpoint &checkpoint) {
+    if (checkpoint.load(fileName) == false) {
+        return false;
+    }
+
+    if (checkpoint.fingerprint != fingerprint || checkpoint.suites.size() != targets.size()) {
+        qCritical() << "The checkpoint does not match the run configuration:"
+                    << fileName;
         return false;
     }
 
-    for (int i = m_seed.size() - 1; i >= 0; i--) {
-        if (m_seed.at(i) < (m_motions.size() - m_seed.size() + i)) {
-            // The value at position i can be increased by one and the
-            // remaining values reset
-            m_seed[i]++;
-            for (int j = i + 1; j < m_seed.size(); j++) {
-                m_seed[j] = m_seed.at(j - 1) + 1;
+    // Check the indices before any suite is created
+    QList<QVector<int>> indices;
+    if (checkpoint.finished == false) {
+        indices << checkpoint.seed;
+    }
+    for (const QList<QVector<int>> &list : checkpoint.suites) {
+        indices << list;
+    }
+
+    for (int j = 0; j < indices.size(); ++j) {
+        // Only the seed may be smaller than a suite
+        if (j >= (checkpoint.finished ? 0 : 1) && indices.at(j).size() != m_suiteSize) {
+            qCritical() << "Corrupt checkpoint:" << fileName;
+            return false;
+        }
+
+        for (int i : indices.at(j)) {
+            if (i < 0 || i >= candidates.size()) {
+                qCritical() << "Corrupt checkpoint:" << fileName;
+                return false;
             }
-            return true;
         }
     }
-    // Shouldn't get here!
-    return false;
+
+    // Rebuild the saved suites of each target
+    for (int t = 0; t < targets.size(); ++t) {
+        TrialSuite trial;
+        trial.reset(m_suiteSize, targets.at(t)->lnSa());
+        for (const QVector<int> &motions : checkpoint.suites.at(t)) {
+            trial.clear();
+            for (int i : motions) {
+                trial.addMotion(i, candidates.at(i)->lnSa().constData());
+            }
+            pools[t].add(trial);
+        }
+    }
+
+    return true;
+}
+
+bool MotionLibrary::mergeSuites(const QList<const TargetSpectrum *> &targets,
+                                const QStringList &fileNames,
+                                QVector<QList<MotionSuite *>> &suites) {
+    const int targetCount = targets.size();
+
+    suites.fill(QList<MotionSuite *>(), targetCount);
+
+    QList<AbstractMotion *> requiredMotions;
+    QList<AbstractMotion *> candidates;
+    screenMotions(candidates, requiredMotions);
+
+    QVector<TrialPool> pools(targetCount);
+    for (TrialPool &pool : pools) {
+        pool.reset(m_suiteCount, m_suiteSize);
+    }
+
+    const QString fingerprint =
+        runFingerprint(runConfiguration(targets, candidates), targets, candidates);
+
+    // Each of the shards needs to be provided once
+    QBitArray shards;
+    for (const QString &fileName : fileNames) {
+        SelectionCheckpoint checkpoint;
+        if (restoreCheckpoint(fileName, fingerprint, targets, candidates, pools,
+                              checkpoint) == false) {
+            return false;
+        }
+
+        if (checkpoint.finished == false) {
+            qCritical() << "The shard is not finished:" << fileName;
+            return false;
+        }
+
+        const int index = checkpoint.configuration.value("shardIndex").toInt();
+        const int count = checkpoint.configuration.value("shardCount").toInt(1);
+        if (shards.isEmpty()) {
+            shards.resize(count);
+        }
+
+        if (count != shards.size() || index < 0 || index >= count || shards.testBit(index)) {
+            qCritical() << "The shard does not belong with the others:" << fileName;
+            return false;
+        }
+        shards.setBit(index);
+    }
+
+    if (shards.isEmpty() || shards.count(true) != shards.size()) {
+        qCritical("Not all of the shards were provided.");
+        return false;
+    }
+
+    createSuites(targets, candidates, pools, suites);
+    emit logText(QString("Merged %1 shards").arg(shards.size()));
+
+    return true;
+}
+
+void MotionLibrary::screenMotions(QList<AbstractMotion *> &candidates,
+                                  QList<AbstractMotion *> &requiredMotions, bool log) {
+    // Screen the motions by the filter. Disabled motions and motions that
+    // do not pass the filter are not candidates, while required motions are
+    // always kept.
+    m_filter.build(m_motions);
+    const QBitArray mask = m_filter.mask();
+
+    for (int i = 0; i < m_motions.size(); ++i) {
+        AbstractMotion *am = m_motions.at(i);
+        if (am->flag() == AbstractMotion::Required) {
+            requiredMotions << am;
+            candidates << am;
+        } else if (am->flag() != AbstractMotion::Disabled && mask.testBit(i)) {
+            candidates << am;
+        }
+    }
+
+    if (log && m_filter.isActive()) {
+        emit logText(QString("Filter retained %1 of %2 motions")
+                .arg(candidates.size()).arg(m_motions.size()));
+    }
 }
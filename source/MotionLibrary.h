@@ -19,16 +19,27 @@
 #ifndef MOTIONLIBRARY_H_
 #define MOTIONLIBRARY_H_
 
+#include "Motion.h"
+#include "MotionFilter.h"
 #include "MotionGroup.h"
+#include "MotionPair.h"
 #include "MotionSuite.h"
+#include "SeedSpace.h"
+#include "TargetSpectrum.h"
+#include "TrialSuite.h"
 
 #include <QAbstractTableModel>
+#include <QJsonObject>
 #include <QLineEdit>
 #include <QList>
 #include <QProgressBar>
 #include <QString>
+#include <QStringList>
 #include <QVector>
 
+class DirectoryScanner;
+struct SelectionCheckpoint;
+
 enum PeriodSpacing {
     Linear,
     Log
@@ -48,6 +59,8 @@ public:
 
     QVector<double> &inputLnStd();
 
+    const TargetSpectrum &target() const;
+
     const QVector<double> &period() const;
 
     const QVector<double> &targetSa() const;
@@ -84,6 +97,18 @@ public:
 
     bool combineComponents() const;
 
+    //! Combination of the spectra of paired components
+    MotionPair::Combination pairCombination() const;
+
+    //! Expression used to screen the motions before the selection
+    QString filter() const;
+
+    //! If the filter expression is valid
+    bool filterIsValid() const;
+
+    //! Description of the error in the filter expression
+    QString filterError() const;
+
     int motionCount() const;
 
     double trialCount() const;
@@ -114,15 +139,54 @@ public:
     //! Start the calculation
     bool compute();
 
+    /*! Select suites for a number of targets with a single pass over the seeds.
+     * The first target defines the periods if the period is not interpolated.
+     * \param targets target spectra, each is prepared at the library periods
+     * \param suites the scaled suites selected for each of the targets
+     * \param mergeFiles if provided, the suites are merged from the results of
+     * the shards instead of being selected
+     * \return true if the operation was successful
+     */
+    bool computeBatch(const QList<TargetSpectrum *> &targets, QVector<QList<MotionSuite *>> &suites,
+                      const QStringList &mergeFiles = QStringList());
+
     //! Read the motions from the files and create the motionGroups
     bool readMotions();
 
+    /*! Pack the record files in the motion path into a single file.
+     * \param fileName name of the packed library (*.sslib)
+     * \param singlePrecision if the acceleration is stored as float32
+     * \return true if the operation was successful
+     */
+    bool pack(const QString &fileName, bool singlePrecision);
+
+    /*! Periodically save the state of the selection to a file.
+     * \param fileName name of the checkpoint, checkpoints are disabled if empty
+     * \param interval time between the checkpoints (sec)
+     */
+    void setCheckpoint(const QString &fileName, int interval);
+
+    //! Continue the selection from the checkpoint file, if it exists
+    void setResume(bool resume);
+
+    /*! Limit the selection to a range of the seeds.
+     * The seeds are divided into equal ranges by their rank. The result of a
+     * shard is its finished checkpoint, which is merged with computeBatch().
+     * \param index index of the shard, starting from 0
+     * \param count number of shards
+     */
+    void setShard(int index, int count);
+
 public slots:
 
     void setDamping(double damping);
 
     void setMotionPath(const QString &path);
 
+    //! Count the motions of the motion path again, as changes on network
+    //! file systems may not be noticed
+    void rescanMotionPath();
+
     void setSuiteSize(int size);
 
     void setSeedSize(int size);
@@ -147,6 +211,16 @@ public slots:
 
     void setCombineComponents(bool b);
 
+    void setPairCombination(int combination);
+
+    void setFilter(const QString &expression);
+
+    //! Update the number of motions found by the scan of the path
+    void setMotionCount(const QString &path, int count);
+
+    //! Log the error of a scan, which runs on a worker thread
+    void reportScanError(const QString &path, const QString &error);
+
     void cancel();
 
 signals:
@@ -162,15 +236,6 @@ signals:
     void trialCountChanged(double);
 
 private:
-    /*! Log-log interpolation.
-         * \param x x values
-         * \param y y values
-         * \param xi x values to interpolate values at
-         * \param yi interpolated y values
-         */
-    static bool
-    interp(const QVector<double> &x, const QVector<double> &y, const QVector<double> &xi, QVector<double> &yi);
-
     //! If it is okay to continue the calcuation
     bool m_okToContinue;
 
@@ -179,44 +244,130 @@ private:
          */
     bool selectSuites();
 
-    /*! Scale the selected suites to the target standard deviation
-         * \return true if the operation was successful
-         */
-    bool scaleSuites();
+    /*! Select the suites for each of the targets.
+     * The seeds are enumerated once and each trial motion is checked against
+     * all of the targets before moving on to the next motion.
+     * \param targets target spectra prepared at the library periods
+     * \param suites selected suites for each of the targets
+     * \return true if the operation was successful
+     */
+    bool selectSuites(const QList<const TargetSpectrum *> &targets, QVector<QList<MotionSuite *>> &suites);
 
-    /*! Count the number of motions found in the path
-         * \return the number of motions found
-         */
-    int countPath(const QString &path);
+    //! Sort the suites and compute the scalars of each of the suites
+    bool scaleSuites(QList<MotionSuite *> &suites);
 
     bool isInputValid();
 
+    /*! If the motions are read without their response spectra. The spectra
+     * of the components combined by RotD are computed with the RotD spectra.
+     */
+    bool deferSpectra() const;
+
+    //! Read the record files found in the motion path
+    bool readFiles(QList<Motion *> &motions);
+
+    //! Read the motions from the packed library at the motion path
+    bool readPacked(QList<Motion *> &motions);
+
+    /*! Pair the components of each event and station into motion pairs.
+     * \param motions sorted components, which are either paired or deleted
+     */
+    void pairComponents(QList<Motion *> &motions);
+
+    //! Report the pairs that use the geometric mean instead of the requested combination
+    void reportCombinationFallbacks();
+
     bool isSuiteValid(const MotionSuite *temp_ms, const MotionGroup *motionGroup);
 
     bool isSuiteValid(const MotionSuite *temp_ms);
 
+    /*! Number of trials shown to the user. The count is exact once the
+     * motions are read and estimated from the number of files otherwise.
+     */
     double countTrials();
 
-    void addSuite(MotionSuite *suite);
+    //! Number of motions checked to grow a seed into a suite
+    double countSteps(int candidateCount) const;
 
-    //! Compute the next seed
-    bool nextSeed();
+    /*! Define the seeds of the candidates.
+     * \param groups station group of each candidate
+     * \param seedSpace seeds of the candidates
+     */
+    void defineSeeds(const QList<AbstractMotion *> &candidates, QVector<int> &groups,
+                     SeedSpace &seedSpace) const;
+
+    /*! Create the MotionSuites of the suites kept during the selection.
+     * \param pools best suites of each target as candidate indices
+     * \param suites the created suites are appended for each target
+     */
+    void createSuites(const QList<const TargetSpectrum *> &targets,
+                      const QList<AbstractMotion *> &candidates,
+                      const QVector<TrialPool> &pools,
+                      QVector<QList<MotionSuite *>> &suites);
+
+    //! Settings of the selection that are saved with a checkpoint
+    QJsonObject runConfiguration(const QList<const TargetSpectrum *> &targets,
+                                 const QList<AbstractMotion *> &candidates) const;
+
+    //! Hash of the configuration, candidates, and targets of the selection
+    QString runFingerprint(const QJsonObject &configuration,
+                           const QList<const TargetSpectrum *> &targets,
+                           const QList<AbstractMotion *> &candidates) const;
+
+    /*! Save the checkpoint of the selection, m_seed is the next seed.
+     * \param count number of seeds evaluated
+     * \param finished if all of the seeds have been evaluated
+     */
+    void saveCheckpoint(const QString &fingerprint, const QJsonObject &configuration,
+                        const QVector<TrialPool> &pools,
+                        quint64 count, bool finished) const;
+
+    /*! Load a checkpoint and add its suites to the saved suites.
+     * \param fileName name of the checkpoint
+     * \param checkpoint the loaded checkpoint
+     * \return false if the checkpoint is invalid or from a different run
+     */
+    bool restoreCheckpoint(const QString &fileName, const QString &fingerprint,
+                           const QList<const TargetSpectrum *> &targets,
+                           const QList<AbstractMotion *> &candidates,
+                           QVector<TrialPool> &pools,
+                           SelectionCheckpoint &checkpoint);
+
+    /*! Merge the results of the shards of a selection.
+     * \param targets target spectra prepared at the library periods
+     * \param fileNames finished checkpoints of all of the shards
+     * \param suites best suites for each of the targets
+     * \return true if the operation was successful
+     */
+    bool mergeSuites(const QList<const TargetSpectrum *> &targets, const QStringList &fileNames,
+                     QVector<QList<MotionSuite *>> &suites);
+
+    /*! Screen the motions that are candidates for the selection.
+     * \param log if the number of motions retained by the filter is logged
+     */
+    void screenMotions(QList<AbstractMotion *> &candidates, QList<AbstractMotion *> &requiredMotions,
+                       bool log = true);
 
     bool m_motionsNeedProcessing;
     QString m_motionPath;
 
+    //! Counts the motions in the path in the background
+    DirectoryScanner *m_scanner;
+
     //! Motions read from files
     QList<AbstractMotion *> m_motions;
 
+    //! Screening of the motions by intensity measures
+    MotionFilter m_filter;
+
+    //! Oscillators used to compute the response spectra of the motions
+    SpectralContextPtr m_context;
+
     //! Damping of the oscillator in percent
     double m_damping;
 
-    //! Input target specified by the user
-    //@{
-    QVector<double> m_inputPeriod;
-    QVector<double> m_inputSa;
-    QVector<double> m_inputLnStd;
-    //@}
+    //! Target specified by the user
+    TargetSpectrum m_target;
 
     bool m_periodInterp;
     int m_periodCount;
@@ -225,11 +376,6 @@ private:
     PeriodSpacing m_periodSpacing;
 
     QVector<double> m_period;
-    QVector<double> m_targetSa;
-    QVector<double> m_targetSaPlusStd;
-    QVector<double> m_targetSaMinusStd;
-    QVector<double> m_targetLnSa;
-    QVector<double> m_targetLnStd;
 
     int m_motionCount;
     int m_disabledCount;
@@ -237,7 +383,19 @@ private:
     int m_suiteSize;
     int m_seedSize;
     double m_trialCount;
-    double m_seedCount;
+
+    //! Checkpoint of the selection
+    QString m_checkpointFile;
+
+    //! Time between checkpoints (sec)
+    int m_checkpointInterval;
+
+    //! If the selection continues from the checkpoint
+    bool m_resume;
+
+    //! Range of the seeds evaluated
+    int m_shardIndex;
+    int m_shardCount;
 
     //! Minimum of marked motions required for the suite
     int m_minRequestedCount;
@@ -254,17 +412,8 @@ private:
      */
     bool m_combineComponents;
 
-    // The worst error (RMSE) value and the location are stored to be quickly replaced with new suites
-    int m_worstLoc;
-    double m_worstError;
-
-    /*! Compute the factorial of an integer.
-     * The factorial of an integer is computed using the Srinivasa Ramanujan approximation.
-     *
-     * \param n integer
-     * \return approximation of the factorial
-     */
-    static double factorial(const int n);
+    //! Combination of the spectra of the components into the spectrum of a pair
+    MotionPair::Combination m_pairCombination;
 };
 
 #endif
@@ -20,28 +20,131 @@
 
 #include <QDebug>
 #include <QDir>
+#include <QObject>
 
-MotionPair::MotionPair(Motion *motionA, Motion *motionB)
-        : AbstractMotion(), m_motionA(motionA), m_motionB(motionB) {
+QStringList MotionPair::combinations() {
+    return QStringList() << QObject::tr("Geometric mean") << QObject::tr("RotD50")
+                         << QObject::tr("RotD100");
+}
+
+MotionPair::MotionPair(Motion *motionA, Motion *motionB, const QList<Motion *> &components,
+                       Combination combination)
+        : AbstractMotion(motionA->context()), m_motionA(motionA), m_motionB(motionB),
+          m_components(components), m_combination(combination),
+          m_effectiveCombination(combination) {
     m_event = m_motionA->event();
     m_station = m_motionA->station();
 
-    m_lnSa.resize(m_period.size());
-    m_sa.resize(m_period.size());
+    if (m_components.isEmpty()) {
+        m_components << m_motionA << m_motionB;
+    }
+
+    Q_ASSERT(m_components.contains(m_motionA) && m_components.contains(m_motionB));
+    Q_ASSERT(m_motionA->context() == m_motionB->context());
+
+    combine();
+
+    // The components that are not combined, or whose RotD spectra could not
+    // be computed, still need their own spectrum
+    for (Motion *motion : m_components) {
+        if (!motion->hasSpectrum()) {
+            motion->calcSpectrum();
+        }
+    }
+}
+
+void MotionPair::setContext(const SpectralContextPtr &context) {
+    for (Motion *motion : m_components) {
+        motion->setContext(context);
+    }
+
+    m_context = context;
+    m_prevScale = 1.0;
+    combine();
+}
+
+bool MotionPair::combine() {
+    m_lnSa.resize(period().size());
+    m_sa.resize(period().size());
+
+    m_effectiveCombination = m_combination;
+    if (m_combination != GeometricMean && updateRotD() == false) {
+        // Fall back to the geometric mean, the caller reports the pairs
+        m_effectiveCombination = GeometricMean;
+    }
+
+    if (m_effectiveCombination == GeometricMean) {
+        for (Motion *motion : {m_motionA, m_motionB}) {
+            if (!motion->hasSpectrum()) {
+                motion->calcSpectrum();
+            }
+        }
+
+        for (int i = 0; i < m_lnSa.size(); ++i) {
+            // Average of the motions added
+            m_lnSa[i] = (m_motionA->lnSa().at(i) + m_motionB->lnSa().at(i)) / 2.;
+        }
+    } else {
+        const QVector<double> &lnRotD =
+            (m_effectiveCombination == RotD50) ? m_lnRotD50 : m_lnRotD100;
+        if (m_rotDContext) {
+            m_lnSa = lnRotD;
+        } else {
+            m_context->interpMaster(lnRotD, m_lnSa);
+        }
+
+        // The RotD spectra are of the unscaled components
+        const double lnScale = log(m_prevScale);
+        for (int i = 0; i < m_lnSa.size(); ++i) {
+            m_lnSa[i] += lnScale;
+        }
+    }
 
     double sum = 0;
-    for (int i = 0; i < m_period.size(); ++i) {
-        // Average of the motions added
-        m_lnSa[i] = (m_motionA->lnSa().at(i) + m_motionB->lnSa().at(i)) / 2.;
+    for (int i = 0; i < m_lnSa.size(); ++i) {
         m_sa[i] = exp(m_lnSa[i]);
         sum += m_lnSa[i];
     }
     m_avgLnSa = sum / m_lnSa.size();
+
+    return m_effectiveCombination == m_combination;
+}
+
+bool MotionPair::updateRotD() {
+    const bool withinMaster = m_context->isWithinMaster();
+
+    if (!m_lnRotD50.isEmpty()) {
+        // The master spectra serve every context within the master periods
+        if (withinMaster && !m_rotDContext) {
+            return true;
+        } else if (!withinMaster && m_rotDContext == m_context) {
+            return true;
+        }
+    }
+
+    const QVector<double> &p = withinMaster ? SpectralContext::masterPeriod() : period();
+
+    QVector<double> rotD50;
+    QVector<double> rotD100;
+    if (Motion::calcRotDSpec(*m_motionA, *m_motionB, p, rotD50, rotD100) == false) {
+        m_lnRotD50.clear();
+        m_lnRotD100.clear();
+        return false;
+    }
+
+    m_lnRotD50.resize(p.size());
+    m_lnRotD100.resize(p.size());
+    for (int i = 0; i < p.size(); ++i) {
+        m_lnRotD50[i] = log(rotD50.at(i));
+        m_lnRotD100[i] = log(rotD100.at(i));
+    }
+    m_rotDContext = withinMaster ? SpectralContextPtr() : m_context;
+
+    return true;
 }
 
 MotionPair::~MotionPair() {
-    delete m_motionA;
-    delete m_motionB;
+    qDeleteAll(m_components);
 }
 
 QString MotionPair::name() const {
@@ -53,8 +156,9 @@ int MotionPair::componentCount() const {
 }
 
 void MotionPair::scaleBy(const double factor) {
-    m_motionA->scaleBy(factor);
-    m_motionB->scaleBy(factor);
+    for (Motion *motion : m_components) {
+        motion->scaleBy(factor);
+    }
 
     AbstractMotion::scaleBy(factor);
 }
@@ -70,3 +174,24 @@ const Motion *MotionPair::motionA() const {
 const Motion *MotionPair::motionB() const {
     return m_motionB;
 }
+
+const QList<Motion *> &MotionPair::components() const {
+    return m_components;
+}
+
+MotionPair::Combination MotionPair::combination() const {
+    return m_combination;
+}
+
+MotionPair::Combination MotionPair::effectiveCombination() const {
+    return m_effectiveCombination;
+}
+
+bool MotionPair::setCombination(Combination combination) {
+    if (combination == m_combination) {
+        return m_effectiveCombination == m_combination;
+    }
+
+    m_combination = combination;
+    return combine();
+}
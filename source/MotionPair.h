@@ -22,19 +22,45 @@
 #include "AbstractMotion.h"
 #include "Motion.h"
 
+#include <QStringList>
+
 class MotionPair : public AbstractMotion {
 public:
-    MotionPair(Motion *motionA, Motion *motionB);
+    //! Combination of the component spectra into the spectrum of the pair
+    enum Combination {
+        GeometricMean, //!< Geometric mean of the components
+        RotD50, //!< Median response over the rotation angles
+        RotD100 //!< Maximum response over the rotation angles
+    };
+
+    static QStringList combinations();
+
+    /*!
+     * \param motionA first horizontal component
+     * \param motionB second horizontal component
+     * \param components all of the components of the event and station,
+     * including the horizontal components, e.g. a triplet with the vertical
+     * component. The pair takes ownership of all of them.
+     * \param combination requested combination. The RotD spectra also give
+     * the spectra of the components that were processed without them.
+     */
+    MotionPair(Motion *motionA, Motion *motionB,
+               const QList<Motion *> &components = QList<Motion *>(),
+               Combination combination = GeometricMean);
 
     ~MotionPair();
 
     virtual QString name() const;
 
+    //! Number of components of the spectrum of the pair
     virtual int componentCount() const;
 
     //! Scale the properties of the motion by a factor
     void scaleBy(const double factor);
 
+    //! Interpolate the response spectrum of both components
+    void setContext(const SpectralContextPtr &context);
+
     //! Check if two motions are from the same event and station
     static bool isAPair(const Motion *motionA, const Motion *motionB);
 
@@ -42,12 +68,55 @@ public:
 
     const Motion *motionB() const;
 
+    //! All of the components of the event and station, in the order of the names
+    const QList<Motion *> &components() const;
+
+    //! Requested combination
+    Combination combination() const;
+
+    //! Combination of the response spectrum, which is the geometric mean if
+    //! the RotD spectra cannot be computed
+    Combination effectiveCombination() const;
+
+    /*! Select the combination and compute the response spectrum again.
+     * \return false if the RotD spectra cannot be computed and the geometric
+     * mean is used instead
+     */
+    bool setCombination(Combination combination);
+
 protected:
+    /*! Compute the response spectrum from the components.
+     * \return false if the requested combination is replaced by the geometric mean
+     */
+    bool combine();
+
+    /*! Compute the RotD spectra, if they are not available for the context.
+     * \return false if the RotD spectra cannot be computed
+     */
+    bool updateRotD();
+
     //! First component
     Motion *m_motionA;
 
     //! Second component
     Motion *m_motionB;
+
+    //! All of the components, including the first and second components
+    QList<Motion *> m_components;
+
+    //! Requested combination
+    Combination m_combination;
+
+    //! Combination used for the response spectrum
+    Combination m_effectiveCombination;
+
+    //! Log RotD50 and RotD100 spectra of the unscaled components, computed
+    //! at the master periods or at the periods of m_rotDContext
+    QVector<double> m_lnRotD50;
+    QVector<double> m_lnRotD100;
+
+    //! Context of the RotD spectra -- null if at the master periods
+    SpectralContextPtr m_rotDContext;
 };
 
 #endif
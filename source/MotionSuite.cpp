@@ -18,10 +18,15 @@
 
 #include "MotionSuite.h"
 #include "MotionPair.h"
+#include "SigmaFit.h"
+#include "SuiteWriter.h"
 
+#include <QHash>
+#include <QMutex>
 #include <QtDebug>
 
 #include <gsl/gsl_cdf.h>
+#include <gsl/gsl_randist.h>
 
 MotionSuite::MotionSuite(const QVector<double> &period, const QVector<double> &targetLnSa,
                          const QVector<double> &targetLnStd)
@@ -39,7 +44,8 @@ QStringList MotionSuite::outputTypes() {
     list << "No Output"
          << "Strata"
          << "CSV"
-         << "SHAKE2000";
+         << "SHAKE2000"
+         << "NumPy";
 
     return list;
 }
@@ -68,6 +74,14 @@ double MotionSuite::stdevError() const {
     return m_stdevError;
 }
 
+double MotionSuite::medianMaxError() const {
+    return m_medianMaxError;
+}
+
+double MotionSuite::sigmaInf() const {
+    return m_sigmaInf;
+}
+
 const QString MotionSuite::errorText() const {
     return QString("Median RMSE: %1   Max Error: %2%   Std RMSE: %3   Sigma Inf: %4")
             .arg(m_medianError, 6, 'f', 4)
@@ -84,6 +98,22 @@ const QVector<double> &MotionSuite::lnStd() const {
     return m_lnStd;
 }
 
+const QVector<double> &MotionSuite::period() const {
+    return m_period;
+}
+
+const QVector<double> &MotionSuite::targetLnSa() const {
+    return m_targetLnSa;
+}
+
+const QVector<double> &MotionSuite::targetLnStd() const {
+    return m_targetLnStd;
+}
+
+const QVector<double> &MotionSuite::lnAvg() const {
+    return m_lnAvg;
+}
+
 QVector<double> MotionSuite::fractile(double eps) const {
     QVector<double> values(m_lnAvg.size());
     for (int i = 0; i < m_lnAvg.size(); ++i) {
@@ -205,7 +235,7 @@ void MotionSuite::computeScalars() {
     //mean and a standard deviation of 1.  The fractiles are ordered from
     //largest to smallest.
 
-    QVector<double> centroids = calcCentroid();
+    const QVector<double> centroids = calcCentroid(m_motions.size());
 
     // Check if a zero sigma value is specified
     bool zeroSigmaValue = false;
@@ -216,13 +246,16 @@ void MotionSuite::computeScalars() {
         }
     }
 
+    SigmaFit fit(m_targetLnSa, m_targetLnStd);
+    fit.setMotions(m_motions, centroids);
+
     double minScale = -1;
     if (zeroSigmaValue) {
         minScale = 1.0;
     } else {
         double minError = 100;
         for (double scale = 0.10; scale < 3; scale += 0.01) {
-            double error = computeStdError(scale, centroids);
+            double error = fit.error(scale);
             if (error < minError) {
                 minError = error;
                 minScale = scale;
@@ -232,7 +265,7 @@ void MotionSuite::computeScalars() {
 
     // Update the RMSE of the suite, compute the scalars, and return the mean of square errors
     m_sigmaInf = minScale;
-    m_stdevError = computeStdError(minScale, centroids);
+    m_stdevError = computeStdError(fit, minScale);
 
     // Sort the motions and the scalars by the name of the motion
     QMap<QString, AbstractMotion *> motionMap;
@@ -253,70 +286,8 @@ void MotionSuite::scaleMotions() {
     }
 }
 
-void MotionSuite::toText(QTextStream &os, MotionSuite::OutputType type) {
-    if (type == SummaryOutput || type == CSVOutput) {
-        scaleMotions();
-        // Print the error information
-        os << QString("Median RMSE,%1\nMedian Max Error (%),%2\nStd RMSE,%3\nSigma Inf,%4\n")
-                .arg(m_medianError)
-                .arg(m_medianMaxError)
-                .arg(m_stdevError)
-                .arg(m_sigmaInf);
-
-        // Print a table of the scaled motions
-        for (int i = 0; i < columnCount(); ++i) {
-            os << headerData(i, Qt::Horizontal, Qt::DisplayRole).toString() << ",";
-        }
-        os << endl;
-
-        for (int row = 0; row < rowCount(); ++row) {
-            for (int col = 0; col < columnCount(); ++col) {
-                os << data(index(row, col), Qt::UserRole).toString() << ",";
-            }
-            os << endl;
-        }
-
-        if (type == CSVOutput) {
-            // Print out the response spectra headers
-            os << "\n\nPeriod (s),Median Sa (g),Sigma_ln";
-            for (int j = 0; j < rowCount(); ++j) {
-                os << "," << selectMotion(j)->name();
-            }
-            os << endl;
-
-            // Print the response spectra data
-            for (int i = 0; i < m_period.size(); ++i) {
-                // Print the period, median, and standard deviation
-                os << m_period.at(i) << "," << exp(m_lnAvg.at(i)) << "," << m_lnStd.at(i);
-                // Print out the individual motions
-                for (int j = 0; j < rowCount(); ++j) {
-                    os << "," << selectMotion(j)->sa().at(i);
-                }
-                os << endl;
-            }
-        }
-    } else if (type == StrataOutput) {
-        for (int i = 0; i < rowCount(); ++i) {
-            os << selectMotion(i)->fileName() << "," << selectScalar(i) << endl;
-        }
-    } else if (type == SHAKE2000Output) {
-        os << QString("Median RMSE: %1 Max Error: %2% Std RMSE: %3 Sigma Inf: %4")
-                .arg(m_medianError, 6, 'f', 4)
-                .arg(m_medianMaxError, 6, 'f', 3)
-                .arg(m_stdevError, 6, 'f', 4)
-                .arg(m_sigmaInf, 4, 'f', 2)
-           << endl;
-
-        os << QString("%1%2").arg("Motion", -80).arg("Scale", -6) << endl;
-
-        // Used to convert between a single motion and paired motion
-        for (int i = 0; i < rowCount(); ++i) {
-            os << QString("%1%2")
-                    .arg(selectMotion(i)->name(), -80)
-                    .arg(selectScalar(i), -6, 'f', 3)
-               << endl;
-        }
-    }
+void MotionSuite::toText(QTextStream &os, MotionSuite::OutputType type) const {
+    os << QString::fromUtf8(SuiteWriter::format(this, type));
 }
 
 int MotionSuite::rowCount(const QModelIndex & /*index*/) const {
@@ -453,36 +424,33 @@ double MotionSuite::computeError(const QVector<double> &vec, const QVector<doubl
     return sqrt(sse / vec.size());
 }
 
-QVector<double> MotionSuite::calcCentroid() {
-    QVector<double> centroid(m_motions.size());
-
-    // Number of slices for each section
-    const int count = 20;
+QVector<double> MotionSuite::calcCentroid(int count) {
+    // The centroids only depend on the number of motions, so they are shared
+    // by all of the suites
+    static QHash<int, QVector<double>> table;
+    static QMutex mutex;
 
-    // Change in the probability for each slice
-    const double dProb = 1.0 / m_motions.size();
-    const double minProb = 0.000001;
+    QMutexLocker locker(&mutex);
+    if (table.contains(count)) {
+        return table.value(count);
+    }
 
-    for (int i = 0; i < m_motions.size(); ++i) {
-        // Compute the bounding probabilities of the slice
-        const double probL = (i == 0) ? minProb : i * dProb;
-        const double probR = (i == m_motions.size() - 1) ? (1 - minProb) : (i + 1) * dProb;
-
-        // Compute the x values corresponding to the probabilities
-        const double xL = gsl_cdf_ugaussian_Pinv(probL);
-        const double xR = gsl_cdf_ugaussian_Pinv(probR);
-
-        // Integration step
-        const double du = (xR - xL) / (count - 1);
-        double moment = 0;
-        for (int j = 0; j < count - 1; ++j) {
-            double uR = xL + (j + 1) * du;
-            double uL = xL + j * du;
-            double area = gsl_cdf_ugaussian_P(uR) - gsl_cdf_ugaussian_P(uL);
-            moment += area * (uL + uR) / 2;
-        }
-        centroid[i] = moment / dProb;
+    // The standard normal distribution is divided into slices of equal
+    // probability. The centroid of the slice between xL and xR is:
+    //   (phi(xL) - phi(xR)) / dProb
+    // where phi is the probability density, which is zero for the tails.
+    const double dProb = 1.0 / count;
+    QVector<double> centroid(count);
+
+    double pdfL = 0;
+    for (int i = 0; i < count; ++i) {
+        const double pdfR = (i == count - 1) ? 0 : gsl_ran_ugaussian_pdf(
+                gsl_cdf_ugaussian_Pinv((i + 1) * dProb));
+        centroid[i] = (pdfL - pdfR) / dProb;
+        pdfL = pdfR;
     }
+
+    table.insert(count, centroid);
     return centroid;
 }
 
@@ -507,54 +475,17 @@ double MotionSuite::selectScalar(int index) const {
  * Apply the scalars to the motions, compute the standard deviation and the
  * mean of squared errors of the standard deviation.
  */
-double MotionSuite::computeStdError(const double sigmaScalar, const QVector<double> &centroids) {
-    // Check that the size of the scalars and motions matches
-    if (m_scalars.size() != m_motions.size()) {
-        m_scalars.resize(m_motions.size());
-    }
-    /*
-         * Scale each of the motions to the appropriate fractile
-         */
-    for (int i = 0; i < m_motions.size(); i++) {
-        double sum = 0;
-        for (int j = 0; j < m_targetLnStd.size(); j++) {
-            double fractile = m_targetLnSa.at(j) + sigmaScalar * m_targetLnStd.at(j) * centroids.at(i);
-            // Compute the sum of the difference between the fractile and the motion
-            sum += fractile - m_motions.at(i)->lnSa().at(j);
-        }
-        // Compute the scalar value in linear space
-        m_scalars[i] = exp(sum / m_targetLnStd.size());
-    }
-    /*
-         * Compute the new average of the suite
-         */
-    for (int i = 0; i < m_lnAvg.size(); i++) {
-        double sum = 0;
-        for (int j = 0; j < m_motions.size(); j++) {
-            sum += m_motions.at(j)->lnSa().at(i) + log(m_scalars.at(j));
-        }
-        m_lnAvg[i] = sum / m_motions.size();
-    }
+double MotionSuite::computeStdError(const SigmaFit &fit, const double sigmaScalar) {
+    m_scalars.resize(m_motions.size());
+    m_lnAvg.resize(m_targetLnSa.size());
+    m_lnStd.resize(m_targetLnStd.size());
 
-    /*
-     * Compute the standard deviation of the suite
-     */
-    if (m_lnStd.size() != m_targetLnStd.size()) {
-        m_lnStd.resize(m_targetLnStd.size());
-    }
-    double sse = 0;
-    for (int i = 0; i < m_targetLnStd.size(); i++) {
-        // The variance is the sum of (x-avg)^2 * p(x).  The probability for
-        // all x's is equal and equal to 1 over the number of values
-        double var = 0;
-        for (int j = 0; j < m_motions.size(); j++) {
-            var += pow(m_motions.at(j)->lnSa().at(i) + log(m_scalars.at(j)) - m_lnAvg.at(i), 2);
-        }
-        // The standard deviation is the square root of the variance
-        m_lnStd[i] = sqrt(var / (m_motions.size() - 1));
-        // Compute the error between the computed and target standard deviation
-        sse += pow(m_lnStd.at(i) - m_targetLnStd.at(i), 2);
+    const double error = fit.error(sigmaScalar, m_scalars.data(), m_lnAvg.data(), m_lnStd.data());
+
+    // Compute the scalar values in linear space
+    for (int i = 0; i < m_scalars.size(); ++i) {
+        m_scalars[i] = exp(m_scalars.at(i));
     }
-    // Return the root mean square error
-    return sqrt(sse / m_targetLnStd.size());
+
+    return error;
 }
@@ -26,6 +26,8 @@
 #include <QList>
 #include <QTextStream>
 
+class SigmaFit;
+
 class MotionSuite : public QAbstractTableModel {
 Q_OBJECT
 
@@ -35,7 +37,8 @@ public:
         SummaryOutput, //!< Only a summary of the motions
         StrataOutput, //!< Output suitable for input into Strata
         CSVOutput, //!< Comma-separated-values suitable for Excel
-        SHAKE2000Output //!< Output suitable for input into SHAKE2000
+        SHAKE2000Output, //!< Output suitable for input into SHAKE2000
+        NumpyOutput //!< Columnar binary arrays of all suites (.npz) for NumPy
     };
 
     MotionSuite(const QVector<double> &period, const QVector<double> &targetLnSa, const QVector<double> &targetLnStd);
@@ -56,12 +59,27 @@ public:
 
     double stdevError() const;
 
+    //! Maximum error in the median (%)
+    double medianMaxError() const;
+
+    //! Factor used to adjust the standard deviation
+    double sigmaInf() const;
+
     const QString errorText() const;
 
     const QVector<double> &avgSa() const;
 
     const QVector<double> &lnStd() const;
 
+    const QVector<double> &period() const;
+
+    const QVector<double> &targetLnSa() const;
+
+    const QVector<double> &targetLnStd() const;
+
+    //! Natural log of the average spectral acceleration
+    const QVector<double> &lnAvg() const;
+
     QVector<double> fractile(double eps) const;
 
     const QList<AbstractMotion *> &motions() const;
@@ -92,7 +110,8 @@ public:
     //! Scale the motions in the suite for plotting
     void scaleMotions();
 
-    void toText(QTextStream &os, OutputType type);
+    //! Write the suite to a text stream, see SuiteWriter
+    void toText(QTextStream &os, OutputType type) const;
 
     int rowCount(const QModelIndex &index = QModelIndex()) const;
 
@@ -123,11 +142,12 @@ private:
     //! Enabled for output
     bool m_enabled;
 
-    //! Compute the error in standard deviation
-    double computeStdError(const double sigmaScalar, const QVector<double> &centroids);
+    //! Scale the suite and compute the error in standard deviation
+    double computeStdError(const SigmaFit &fit, const double sigmaScalar);
 
-    //! Compute the centroids for the suite
-    QVector<double> calcCentroid();
+    //! Centroids of equal probability slices of the standard normal
+    //! distribution, which are computed once for each number of motions
+    static QVector<double> calcCentroid(int count);
 
     //! User defined rank of the suite
     int m_rank;
@@ -0,0 +1,274 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#include "PackedLibrary.h"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QtDebug>
+#include <QtEndian>
+
+#include <cstring>
+
+namespace {
+    const char Magic[8] = {'S', 'S', 'L', 'I', 'B', '\0', '\0', '\0'};
+
+    //! Serialization of the metadata, fixed so that the format does not
+    //! depend on the version of Qt
+    const int StreamVersion = QDataStream::Qt_5_0;
+
+    QDataStream &operator<<(QDataStream &out, const PackedLibrary::Record &r) {
+        out << r.fileName << r.event << r.station << r.component << r.details
+            << r.dt << qint32(r.count) << r.singlePrecision << r.offset;
+        return out;
+    }
+
+    QDataStream &operator>>(QDataStream &in, PackedLibrary::Record &r) {
+        qint32 count;
+        in >> r.fileName >> r.event >> r.station >> r.component >> r.details
+           >> r.dt >> count >> r.singlePrecision >> r.offset;
+        r.count = count;
+        return in;
+    }
+}
+
+PackedLibrary::PackedLibrary()
+        : m_data(0), m_singlePrecision(false) {
+}
+
+PackedLibrary::~PackedLibrary() {
+    close();
+}
+
+bool PackedLibrary::isPacked(const QString &path) {
+    return path.endsWith(".sslib", Qt::CaseInsensitive);
+}
+
+bool PackedLibrary::open(const QString &fileName) {
+    close();
+    m_errorString.clear();
+
+    m_file.setFileName(fileName);
+    if (m_file.open(QIODevice::ReadOnly) == false) {
+        m_errorString = QString("Unable to open file: %1").arg(fileName);
+        return false;
+    }
+
+    const qint64 size = m_file.size();
+    if (size < HeaderSize) {
+        m_errorString = QString("Not a packed motion library: %1").arg(fileName);
+        close();
+        return false;
+    }
+
+    m_data = m_file.map(0, size);
+    if (m_data == 0) {
+        m_errorString = QString("Unable to map file: %1").arg(fileName);
+        close();
+        return false;
+    }
+
+    if (memcmp(m_data, Magic, sizeof(Magic)) != 0
+        || qFromLittleEndian<quint32>(m_data + 8) != Version) {
+        m_errorString = QString("Not a packed motion library: %1").arg(fileName);
+        close();
+        return false;
+    }
+
+    const quint32 count = qFromLittleEndian<quint32>(m_data + 12);
+    const qint64 metadataOffset = qFromLittleEndian<qint64>(m_data + 16);
+    const qint64 metadataSize = qFromLittleEndian<qint64>(m_data + 24);
+
+    if (metadataOffset < HeaderSize || metadataSize < 0
+        || metadataOffset + metadataSize > size) {
+        m_errorString = QString("Corrupt packed motion library: %1").arg(fileName);
+        close();
+        return false;
+    }
+
+    const QByteArray metadata = QByteArray::fromRawData(
+            reinterpret_cast<const char *>(m_data + metadataOffset), int(metadataSize));
+    QDataStream in(metadata);
+    in.setVersion(StreamVersion);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    for (quint32 i = 0; i < count; ++i) {
+        Record r;
+        in >> r;
+
+        const qint64 blockSize = qint64(r.count) * (r.singlePrecision ? 4 : 8);
+        if (in.status() != QDataStream::Ok || r.count <= 0 || r.offset < HeaderSize
+            || r.offset + blockSize > metadataOffset) {
+            m_errorString = QString("Corrupt packed motion library: %1").arg(fileName);
+            close();
+            return false;
+        }
+
+        m_records << r;
+    }
+
+    return true;
+}
+
+const QString &PackedLibrary::errorString() const {
+    return m_errorString;
+}
+
+void PackedLibrary::close() {
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+        m_data = 0;
+    }
+    m_file.close();
+    m_records.clear();
+
+    // A library that was created but not finished is discarded
+    if (!m_fileName.isEmpty()) {
+        m_file.remove();
+        m_fileName.clear();
+    }
+}
+
+int PackedLibrary::count() const {
+    return m_records.size();
+}
+
+const PackedLibrary::Record &PackedLibrary::record(int index) const {
+    return m_records.at(index);
+}
+
+void PackedLibrary::readAcc(int index, QVector<double> &acc) const {
+    const Record &r = m_records.at(index);
+    const uchar *block = m_data + r.offset;
+
+    acc.resize(r.count);
+    double *values = acc.data();
+
+    if (r.singlePrecision) {
+        for (int i = 0; i < r.count; ++i) {
+            const quint32 bits = qFromLittleEndian<quint32>(block + 4 * i);
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            values[i] = value;
+        }
+    } else {
+        for (int i = 0; i < r.count; ++i) {
+            const quint64 bits = qFromLittleEndian<quint64>(block + 8 * i);
+            memcpy(values + i, &bits, sizeof(double));
+        }
+    }
+}
+
+bool PackedLibrary::create(const QString &fileName, bool singlePrecision) {
+    close();
+    m_singlePrecision = singlePrecision;
+
+    // The library is written to a temporary file, which replaces the file by
+    // finish(), so that an existing file is kept if the writing fails
+    m_file.setFileName(fileName + ".tmp");
+    if (m_file.open(QIODevice::WriteOnly | QIODevice::Truncate) == false) {
+        qCritical() << "Unable to open file:" << m_file.fileName();
+        return false;
+    }
+    m_fileName = fileName;
+
+    // The header is completed by finish()
+    return writeHeader(0, 0);
+}
+
+bool PackedLibrary::append(Record record, const QVector<double> &acc) {
+    // Align the blocks to 8 bytes
+    const qint64 padding = (8 - m_file.pos() % 8) % 8;
+    if (padding) {
+        m_file.write(QByteArray(int(padding), '\0'));
+    }
+
+    record.count = acc.size();
+    record.singlePrecision = m_singlePrecision;
+    record.offset = m_file.pos();
+
+    QByteArray block(acc.size() * (m_singlePrecision ? 4 : 8), Qt::Uninitialized);
+    uchar *dest = reinterpret_cast<uchar *>(block.data());
+
+    if (m_singlePrecision) {
+        for (int i = 0; i < acc.size(); ++i) {
+            const float value = acc.at(i);
+            quint32 bits;
+            memcpy(&bits, &value, sizeof(bits));
+            qToLittleEndian<quint32>(bits, dest + 4 * i);
+        }
+    } else {
+        for (int i = 0; i < acc.size(); ++i) {
+            quint64 bits;
+            memcpy(&bits, acc.constData() + i, sizeof(bits));
+            qToLittleEndian<quint64>(bits, dest + 8 * i);
+        }
+    }
+
+    if (m_file.write(block) != block.size()) {
+        qCritical() << "Unable to write to file:" << m_file.fileName();
+        return false;
+    }
+
+    m_records << record;
+    return true;
+}
+
+bool PackedLibrary::finish() {
+    QByteArray metadata;
+    QDataStream out(&metadata, QIODevice::WriteOnly);
+    out.setVersion(StreamVersion);
+    out.setByteOrder(QDataStream::LittleEndian);
+    for (const Record &r : m_records) {
+        out << r;
+    }
+
+    const qint64 metadataOffset = m_file.pos();
+    if (m_file.write(metadata) != metadata.size()
+        || m_file.seek(0) == false
+        || writeHeader(metadataOffset, metadata.size()) == false) {
+        qCritical() << "Unable to write to file:" << m_file.fileName();
+        close();
+        return false;
+    }
+    m_file.close();
+
+    if ((QFile::exists(m_fileName) && QFile::remove(m_fileName) == false)
+        || m_file.rename(m_fileName) == false) {
+        qCritical() << "Unable to replace file:" << m_fileName;
+        close();
+        return false;
+    }
+
+    m_fileName.clear();
+    close();
+    return true;
+}
+
+bool PackedLibrary::writeHeader(qint64 metadataOffset, qint64 metadataSize) {
+    QByteArray header(HeaderSize, '\0');
+    uchar *dest = reinterpret_cast<uchar *>(header.data());
+
+    memcpy(dest, Magic, sizeof(Magic));
+    qToLittleEndian<quint32>(Version, dest + 8);
+    qToLittleEndian<quint32>(quint32(m_records.size()), dest + 12);
+    qToLittleEndian<qint64>(metadataOffset, dest + 16);
+    qToLittleEndian<qint64>(metadataSize, dest + 24);
+
+    return m_file.write(header) == header.size();
+}
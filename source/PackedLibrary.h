@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PACKED_LIBRARY_H_
+#define PACKED_LIBRARY_H_
+
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+/*! PackedLibrary reads and writes a motion library packed into a single file.
+ *
+ * The file (*.sslib) is composed of:
+ *  - a fixed header: magic, version, record count, and the location of the
+ *    metadata table,
+ *  - the acceleration of each record as a contiguous block of little-endian
+ *    float32 or float64 values,
+ *  - the metadata table of the records serialized with QDataStream.
+ *
+ * The file is memory mapped read-only when opened, so that the records can be
+ * accessed in any order and the file can be shared by several processes.
+ */
+class PackedLibrary {
+public:
+    //! Metadata of a record in the library
+    struct Record {
+        //! Name of the original file relative to the library path
+        QString fileName;
+        QString event;
+        QString station;
+        QString component;
+        QString details;
+
+        //! Time step (sec)
+        double dt;
+
+        //! Number of acceleration values
+        int count;
+
+        //! If the acceleration is stored in single precision
+        bool singlePrecision;
+
+        //! Location of the acceleration block in the file
+        qint64 offset;
+    };
+
+    PackedLibrary();
+
+    ~PackedLibrary();
+
+    //! Check if the path refers to a packed library
+    static bool isPacked(const QString &path);
+
+    /*! Open and map a packed library for reading. Errors are not reported,
+     * so that a library can be opened on a worker thread; see errorString().
+     * \param fileName name of the file
+     * \return true if the file is a valid library
+     */
+    bool open(const QString &fileName);
+
+    //! Description of the error of the last open()
+    const QString &errorString() const;
+
+    //! Close the library
+    void close();
+
+    //! Number of records in the library
+    int count() const;
+
+    const Record &record(int index) const;
+
+    /*! Read the acceleration of a record.
+     * \param index index of the record
+     * \param acc acceleration (g)
+     */
+    void readAcc(int index, QVector<double> &acc) const;
+
+    /*! Create a library for writing. The records are written to a temporary
+     * file, which replaces the file once finish() succeeds and is removed if
+     * the library is closed before.
+     * \param fileName name of the file
+     * \param singlePrecision if the acceleration is stored as float32
+     * \return true if the file was created
+     */
+    bool create(const QString &fileName, bool singlePrecision);
+
+    /*! Append a record to a library opened with create().
+     * \param record metadata of the record, the offset is assigned
+     * \param acc acceleration (g)
+     */
+    bool append(Record record, const QVector<double> &acc);
+
+    //! Write the metadata table and header of the library, and move it to
+    //! the name given to create()
+    bool finish();
+
+private:
+    //! Version of the file format
+    static const quint32 Version = 1;
+
+    //! Size of the header in bytes
+    static const qint64 HeaderSize = 32;
+
+    //! Write the header
+    bool writeHeader(qint64 metadataOffset, qint64 metadataSize);
+
+    QFile m_file;
+
+    //! Name of the library being written -- empty when reading
+    QString m_fileName;
+
+    //! Mapped contents of the file
+    const uchar *m_data;
+
+    //! Records in the library
+    QList<Record> m_records;
+
+    //! Precision used when writing
+    bool m_singlePrecision;
+
+    QString m_errorString;
+};
+
+#endif
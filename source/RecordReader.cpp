@@ -0,0 +1,752 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#include "RecordReader.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    //! Standard gravity in cm/sec^2
+    const double Gravity = 980.665;
+
+    //! Number of bytes that are sniffed
+    const int HeadSize = 4096;
+
+    inline bool isLineBreak(char c) {
+        return c == '\n' || c == '\r';
+    }
+
+    inline bool isSpace(char c) {
+        return c == ' ' || c == '\t';
+    }
+
+    inline bool isSeparator(char c) {
+        return isSpace(c) || isLineBreak(c) || c == ',';
+    }
+
+    inline bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    //! Factor to convert acceleration in the units to g, zero if unknown
+    double unitFactor(const QString &units) {
+        const QString u = units.trimmed().toLower();
+        if (u.startsWith("gal") || u.startsWith("cm")) {
+            return 1 / Gravity;
+        } else if (u.startsWith("mm")) {
+            return 0.1 / Gravity;
+        } else if (u.startsWith("m")) {
+            return 100 / Gravity;
+        } else if (u.startsWith("g")) {
+            return 1;
+        }
+        return 0;
+    }
+
+    //! Check if the text contains a string
+    bool contains(const char *begin, const char *end, const char *text) {
+        return std::search(begin, end, text, text + strlen(text)) != end;
+    }
+
+    //! Read a number of fixed width values and move to the next line
+    bool readFields(TextCursor &cursor, int count, int width, QVector<double> &values) {
+        values.resize(count);
+        for (int i = 0; i < count; ++i) {
+            if (cursor.readField(width, values.data() + i) == false) {
+                return false;
+            }
+        }
+        cursor.skipLines(0);
+        return true;
+    }
+}
+
+TextCursor::TextCursor(const char *begin, const char *end)
+        : m_pos(begin), m_end(end), m_begin(begin) {
+}
+
+bool TextCursor::atEnd() const {
+    return m_pos >= m_end;
+}
+
+bool TextCursor::readLine(const char **begin, const char **end) {
+    if (atEnd()) {
+        return false;
+    }
+
+    *begin = m_pos;
+    while (m_pos < m_end && !isLineBreak(*m_pos)) {
+        ++m_pos;
+    }
+    *end = m_pos;
+
+    // Line endings of \r\n, \n, or \r
+    if (m_pos < m_end && *m_pos == '\r') {
+        ++m_pos;
+    }
+    if (m_pos < m_end && *m_pos == '\n') {
+        ++m_pos;
+    }
+    return true;
+}
+
+QString TextCursor::readLine() {
+    const char *begin;
+    const char *end;
+    if (readLine(&begin, &end) == false) {
+        return QString();
+    }
+    return QString::fromLatin1(begin, int(end - begin));
+}
+
+void TextCursor::skipLines(int count) {
+    const char *begin;
+    const char *end;
+
+    // Finish the current line
+    if (m_pos > m_begin && !isLineBreak(m_pos[-1])) {
+        readLine(&begin, &end);
+    }
+
+    for (int i = 0; i < count && readLine(&begin, &end); ++i) {
+    }
+}
+
+bool TextCursor::readDouble(double *value) {
+    while (m_pos < m_end && isSeparator(*m_pos)) {
+        ++m_pos;
+    }
+    if (atEnd()) {
+        return false;
+    }
+
+    const char *begin = m_pos;
+    while (m_pos < m_end && !isSeparator(*m_pos)) {
+        ++m_pos;
+    }
+    return toDouble(begin, m_pos, value);
+}
+
+bool TextCursor::readField(int width, double *value) {
+    while (true) {
+        while (m_pos < m_end && isLineBreak(*m_pos)) {
+            ++m_pos;
+        }
+        if (atEnd()) {
+            return false;
+        }
+
+        const char *begin = m_pos;
+        const char *stop = (width < m_end - begin) ? begin + width : m_end;
+        while (m_pos < stop && !isLineBreak(*m_pos)) {
+            ++m_pos;
+        }
+
+        const char *p = begin;
+        while (p < m_pos && isSpace(*p)) {
+            ++p;
+        }
+
+        if (p < m_pos) {
+            return toDouble(begin, m_pos, value);
+        }
+
+        // A blank field ends the values of the line
+        while (m_pos < m_end && !isLineBreak(*m_pos)) {
+            ++m_pos;
+        }
+    }
+}
+
+bool TextCursor::toDouble(const char *begin, const char *end, double *value) {
+    static const double powers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    while (begin < end && isSpace(*begin)) {
+        ++begin;
+    }
+    while (end > begin && isSpace(end[-1])) {
+        --end;
+    }
+
+    const char *p = begin;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    // Significant digits are accumulated as an integer. Digits beyond 19 are
+    // dropped, in which case the slow path is used below.
+    quint64 mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+
+    for (; p < end && isDigit(*p); ++p) {
+        any = true;
+        if (digits < 19) {
+            mantissa = 10 * mantissa + (*p - '0');
+            digits += (mantissa > 0);
+        } else {
+            ++exponent;
+        }
+    }
+
+    if (p < end && *p == '.') {
+        for (++p; p < end && isDigit(*p); ++p) {
+            any = true;
+            if (digits < 19) {
+                mantissa = 10 * mantissa + (*p - '0');
+                digits += (mantissa > 0);
+                --exponent;
+            }
+        }
+    }
+
+    if (any == false) {
+        return false;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E' || *p == 'd' || *p == 'D')) {
+        ++p;
+        bool negativeExp = false;
+        if (p < end && (*p == '+' || *p == '-')) {
+            negativeExp = (*p == '-');
+            ++p;
+        }
+        if (p == end || !isDigit(*p)) {
+            return false;
+        }
+
+        int e = 0;
+        for (; p < end && isDigit(*p); ++p) {
+            e = qMin(10 * e + (*p - '0'), 100000);
+        }
+        exponent += negativeExp ? -e : e;
+    }
+
+    if (p != end) {
+        return false;
+    }
+
+    // With at most 15 digits the mantissa and the power of ten are exact, so
+    // a single multiplication or division is correctly rounded
+    if (digits <= 15 && -22 <= exponent && exponent <= 22) {
+        double v = double(mantissa);
+        v = (exponent < 0) ? v / powers[-exponent] : v * powers[exponent];
+        *value = negative ? -v : v;
+        return true;
+    }
+
+    QByteArray text(begin, int(end - begin));
+    for (int i = 0; i < text.size(); ++i) {
+        if (text.at(i) == 'd' || text.at(i) == 'D') {
+            text[i] = 'e';
+        }
+    }
+
+    bool ok = false;
+    *value = text.toDouble(&ok);
+    return ok;
+}
+
+namespace {
+    /*! Reader of the AT2 files of the PEER ground motion database.
+     */
+    class At2Reader : public RecordReader {
+    public:
+        QString name() const {
+            return "PEER AT2";
+        }
+
+        QStringList nameFilters() const {
+            return QStringList() << "*.at2";
+        }
+
+        bool sniff(const char *begin, const char *end) const {
+            // The fourth line provides the number of points and time step
+            TextCursor cursor(begin, end);
+            const char *lineBegin = 0;
+            const char *lineEnd = 0;
+            for (int i = 0; i < 4; ++i) {
+                if (cursor.readLine(&lineBegin, &lineEnd) == false) {
+                    return false;
+                }
+            }
+            return contains(lineBegin, lineEnd, "NPTS");
+        }
+
+        bool read(const QString &fileName, const char *begin, const char *end,
+                  Record &record) const {
+            TextCursor cursor(begin, end);
+
+            const char *lineBegin[4];
+            const char *lineEnd[4];
+            for (int i = 0; i < 4; ++i) {
+                if (cursor.readLine(lineBegin + i, lineEnd + i) == false) {
+                    return false;
+                }
+            }
+
+            int count;
+            if (!parseMetadata(fileName, lineBegin, lineEnd, record, &count)) {
+                return false;
+            }
+
+            // Values that are missing are left as zero
+            record.acc.fill(0., count);
+            double *acc = record.acc.data();
+            for (int i = 0; i < count && cursor.readDouble(acc + i); ++i) {
+            }
+
+            return true;
+        }
+
+    private:
+        /*! Parse metadata from the header lines and filename.
+         *
+         * AT2 files contain 4 header lines:
+         * (0) Not important
+         * (1) Event information
+         * (2) Not important
+         * (3) number of data points, time step
+         *
+         * The header lines are parsed in place. Regular expressions are only
+         * used for the legacy formats, and are compiled once.
+         */
+        bool parseMetadata(const QString &fileName, const char *const *lineBegin,
+                           const char *const *lineEnd, Record &record, int *count) const {
+            static const QRegularExpression legacyRx("NPTS=\\s+(\\d+), DT=\\s+([0-9.]+) SEC,?");
+
+            record.details = QString::fromLatin1(lineBegin[1], int(lineEnd[1] - lineBegin[1]))
+                    .trimmed();
+
+            // The modern format provides the event, date, station, and
+            // component separated by commas
+            if (std::count(lineBegin[1], lineEnd[1], ',') == 3) {
+                const int a = record.details.indexOf(',');
+                const int b = record.details.indexOf(',', a + 1);
+                const int c = record.details.indexOf(',', b + 1);
+                record.event = record.details.left(a).trimmed();
+                record.station = record.details.mid(b + 1, c - b - 1).trimmed();
+                record.component = record.details.mid(c + 1).trimmed();
+            }
+
+            // The older formatted PEER motions require specific file structure.
+            if (record.component.isEmpty()) {
+                parsePath(fileName, record);
+            }
+
+            *count = 0;
+
+            // Example: 8751    0.0040    NPTS, DT
+            TextCursor line(lineBegin[3], lineEnd[3]);
+            double n;
+            double dt;
+            if (line.readDouble(&n) && line.readDouble(&dt)
+                && contains(lineBegin[3], lineEnd[3], "NPTS")) {
+                *count = int(n);
+                record.dt = dt;
+            } else {
+                // Example: NPTS=   7998, DT=   .0050 SEC,
+                // Example: NPTS=   3666, DT=   0.025 SEC
+                const QRegularExpressionMatch m = legacyRx.match(
+                        QString::fromLatin1(lineBegin[3], int(lineEnd[3] - lineBegin[3])));
+                if (m.hasMatch()) {
+                    *count = m.captured(1).toInt();
+                    record.dt = m.captured(2).toDouble();
+                }
+            }
+
+            return !record.component.isEmpty() && (*count > 0) && (record.dt > 0);
+        }
+    };
+
+    /*! Reader of the corrected acceleration (V2) files of the COSMOS
+     * strong-motion data format.
+     *
+     * The text header is followed by the integer and real headers, comments,
+     * and the data. Each block is introduced by a line that provides the
+     * number of values and the Fortran format. The time step is the 62nd real
+     * header value.
+     */
+    class CosmosReader : public RecordReader {
+    public:
+        QString name() const {
+            return "COSMOS V2";
+        }
+
+        QStringList nameFilters() const {
+            return QStringList() << "*.v2" << "*.v2c";
+        }
+
+        bool sniff(const char *begin, const char *end) const {
+            TextCursor cursor(begin, end);
+            const QString line = cursor.readLine();
+            return line.contains("Corrected acc", Qt::CaseInsensitive)
+                   && line.contains("text lines", Qt::CaseInsensitive);
+        }
+
+        bool read(const QString &fileName, const char *begin, const char *end,
+                  Record &record) const {
+            static const QRegularExpression textRx("with\\s+(\\d+)\\s+text lines",
+                                                   QRegularExpression::CaseInsensitiveOption);
+            static const QRegularExpression headerRx(
+                    "^\\s*(\\d+)\\s+(Integer|Real)-header values follow on\\s+(\\d+)\\s+lines"
+                    ".*Format=\\s*\\((\\d+)[A-Z](\\d+)",
+                    QRegularExpression::CaseInsensitiveOption);
+            static const QRegularExpression commentRx("^\\s*(\\d+)\\s+Comment line",
+                                                      QRegularExpression::CaseInsensitiveOption);
+            static const QRegularExpression dataRx(
+                    "^\\s*(\\d+)\\s+acceleration pts.*units=\\s*([^,(]+)"
+                    ".*Format=\\s*\\((\\d+)[A-Z](\\d+)",
+                    QRegularExpression::CaseInsensitiveOption);
+
+            TextCursor cursor(begin, end);
+
+            QRegularExpressionMatch m = textRx.match(cursor.readLine());
+            if (!m.hasMatch()) {
+                return false;
+            }
+            const int textCount = m.captured(1).toInt();
+
+            // The second line describes the earthquake
+            record.details = cursor.readLine().trimmed();
+            cursor.skipLines(textCount - 2);
+
+            QVector<double> real;
+            for (int i = 0; i < 2; ++i) {
+                m = headerRx.match(cursor.readLine());
+                if (!m.hasMatch()) {
+                    return false;
+                }
+
+                if (m.captured(2).compare("Real", Qt::CaseInsensitive) == 0) {
+                    if (!readFields(cursor, m.captured(1).toInt(), m.captured(5).toInt(), real)) {
+                        return false;
+                    }
+                } else {
+                    cursor.skipLines(m.captured(3).toInt());
+                }
+            }
+
+            // Comment lines are optional
+            QString line = cursor.readLine();
+            m = commentRx.match(line);
+            if (m.hasMatch()) {
+                cursor.skipLines(m.captured(1).toInt());
+                line = cursor.readLine();
+            }
+
+            m = dataRx.match(line);
+            if (!m.hasMatch() || real.size() < 62) {
+                return false;
+            }
+
+            const double factor = unitFactor(m.captured(2));
+            record.dt = real.at(61);
+            if (factor <= 0 || record.dt <= 0
+                || !readFields(cursor, m.captured(1).toInt(), m.captured(4).toInt(), record.acc)) {
+                return false;
+            }
+
+            for (int i = 0; i < record.acc.size(); ++i) {
+                record.acc[i] *= factor;
+            }
+
+            parseName(fileName, record);
+            return record.acc.size() > 0;
+        }
+    };
+
+    /*! Reader of the corrected accelerograms in the strong-motion CD (SMC)
+     * format of the USGS.
+     *
+     * There are 11 text lines, 48 integers (8I10), 50 reals (5E15.7), a number
+     * of comment lines, and the data (8E10.4) in cm/sec^2. The number of
+     * comments and points are the 16th and 17th integers and the sampling
+     * rate is the 2nd real.
+     */
+    class SmcReader : public RecordReader {
+    public:
+        QString name() const {
+            return "SMC";
+        }
+
+        QStringList nameFilters() const {
+            return QStringList() << "*.smc";
+        }
+
+        bool sniff(const char *begin, const char *end) const {
+            // Data type 2 is the corrected acceleration
+            TextCursor cursor(begin, end);
+            const QString line = cursor.readLine().trimmed();
+            return line.startsWith("2") && line.contains("CORRECTED ACCELEROGRAM");
+        }
+
+        bool read(const QString &fileName, const char *begin, const char *end,
+                  Record &record) const {
+            TextCursor cursor(begin, end);
+
+            if (sniff(begin, end) == false) {
+                return false;
+            }
+            cursor.skipLines(1);
+            record.details = cursor.readLine().trimmed();
+            cursor.skipLines(9);
+
+            QVector<double> integer;
+            QVector<double> real;
+            if (!readFields(cursor, 48, 10, integer) || !readFields(cursor, 50, 15, real)) {
+                return false;
+            }
+
+            const int commentCount = int(integer.at(15));
+            const int count = int(integer.at(16));
+            const double rate = real.at(1);
+            if (commentCount < 0 || count <= 0 || rate <= 0) {
+                return false;
+            }
+            cursor.skipLines(commentCount);
+
+            record.dt = 1 / rate;
+            if (!readFields(cursor, count, 10, record.acc)) {
+                return false;
+            }
+
+            for (int i = 0; i < record.acc.size(); ++i) {
+                record.acc[i] /= Gravity;
+            }
+
+            parseName(fileName, record);
+            return true;
+        }
+    };
+
+    /*! Reader of time and acceleration (g) in two columns, separated by white
+     * space or a comma. Header lines that do not start with a number are
+     * skipped.
+     */
+    class TwoColumnReader : public RecordReader {
+    public:
+        QString name() const {
+            return "Two column";
+        }
+
+        QStringList nameFilters() const {
+            return QStringList() << "*.txt" << "*.dat";
+        }
+
+        bool sniff(const char *begin, const char *end) const {
+            TextCursor cursor(begin, end);
+            const char *lineBegin;
+            const char *lineEnd;
+            while (cursor.readLine(&lineBegin, &lineEnd)) {
+                double first;
+                double second;
+                double extra;
+                TextCursor line(lineBegin, lineEnd);
+                if (line.readDouble(&first)) {
+                    // The first line of data has two values
+                    return line.readDouble(&second) && !line.readDouble(&extra);
+                }
+            }
+            return false;
+        }
+
+        bool read(const QString &fileName, const char *begin, const char *end,
+                  Record &record) const {
+            QVector<double> time;
+            TextCursor cursor(begin, end);
+            const char *lineBegin;
+            const char *lineEnd;
+            while (cursor.readLine(&lineBegin, &lineEnd)) {
+                double t;
+                double a;
+                TextCursor line(lineBegin, lineEnd);
+                if (line.readDouble(&t) && line.readDouble(&a)) {
+                    time << t;
+                    record.acc << a;
+                } else if (!time.isEmpty()
+                           && std::any_of(lineBegin, lineEnd,
+                                          [](char c) { return !isSeparator(c); })) {
+                    // A line that is not data
+                    return false;
+                }
+            }
+
+            if (time.size() < 2) {
+                return false;
+            }
+
+            // The time step must be constant
+            record.dt = (time.last() - time.first()) / (time.size() - 1);
+            for (int i = 0; i < time.size(); ++i) {
+                if (fabs(time.at(i) - time.first() - i * record.dt) > 0.01 * record.dt) {
+                    // The time step is not constant
+                    return false;
+                }
+            }
+
+            parseName(fileName, record);
+            return record.dt > 0;
+        }
+    };
+
+    //! Readers of the registry, which are deleted when the program exits
+    struct Registry {
+        Registry() {
+            readers << new At2Reader << new CosmosReader << new SmcReader;
+        }
+
+        ~Registry() {
+            qDeleteAll(readers);
+        }
+
+        QList<RecordReader *> readers;
+    };
+}
+
+RecordReader::Record::Record()
+        : dt(0) {
+}
+
+RecordReader::~RecordReader() {
+}
+
+QList<RecordReader *> &RecordReader::registry() {
+    static Registry registry;
+    return registry.readers;
+}
+
+void RecordReader::add(RecordReader *reader) {
+    registry() << reader;
+}
+
+RecordReader *RecordReader::createTwoColumnReader() {
+    return new TwoColumnReader;
+}
+
+const QList<RecordReader *> &RecordReader::readers() {
+    return registry();
+}
+
+QStringList RecordReader::allNameFilters() {
+    QStringList filters;
+    for (const RecordReader *reader : readers()) {
+        for (const QString &filter : reader->nameFilters()) {
+            filters << filter.toLower() << filter.toUpper();
+        }
+    }
+    filters.removeDuplicates();
+    return filters;
+}
+
+const RecordReader *RecordReader::find(const QString &fileName, const char *begin,
+                                       const char *end) {
+    const QString name = QFileInfo(fileName).fileName();
+
+    // Readers of the extension that recognize the contents are preferred,
+    // then any reader that recognizes the contents. A file that no reader
+    // recognizes is not read.
+    for (const RecordReader *reader : readers()) {
+        bool matches = false;
+        for (const QString &filter : reader->nameFilters()) {
+            matches = matches || QDir::match(filter, name);
+        }
+
+        if (matches && reader->sniff(begin, end)) {
+            return reader;
+        }
+    }
+
+    for (const RecordReader *reader : readers()) {
+        if (reader->sniff(begin, end)) {
+            return reader;
+        }
+    }
+
+    return 0;
+}
+
+bool RecordReader::readFile(const QString &fileName, Record &record) {
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly) == false) {
+        return false;
+    }
+
+    // The file is mapped, or read if it cannot be mapped
+    const qint64 size = file.size();
+    uchar *data = (size > 0) ? file.map(0, size) : 0;
+
+    QByteArray contents;
+    if (data == 0) {
+        contents = file.readAll();
+    }
+
+    const char *begin = data ? reinterpret_cast<const char *>(data) : contents.constData();
+    const char *end = begin + (data ? size : contents.size());
+    const char *head = (end - begin > HeadSize) ? begin + HeadSize : end;
+
+    bool ok = false;
+    const RecordReader *reader = find(fileName, begin, head);
+    if (reader) {
+        ok = reader->read(QFileInfo(fileName).absoluteFilePath(), begin, end, record);
+    }
+
+    if (data) {
+        file.unmap(data);
+    }
+    return ok;
+}
+
+bool RecordReader::parsePath(const QString &fileName, Record &record) {
+    static const QRegularExpression rx(".*/([^/]+)/"
+                                       "([^/]+)((?:\\d{3})|(?:-{0,2}[NSEWTLR]+)|"
+                                       "(?:NOR)|(?:SOU)|(?:EAS)|(?:WES))"
+                                       "(\\.[^./]+$)");
+
+    const QRegularExpressionMatch m = rx.match(
+            QDir::isAbsolutePath(fileName) ? fileName : QFileInfo(fileName).absoluteFilePath());
+    if (m.hasMatch() == false) {
+        return false;
+    }
+
+    record.event = m.captured(1);
+    record.station = m.captured(2);
+    record.component = m.captured(3);
+    return true;
+}
+
+void RecordReader::parseName(const QString &fileName, Record &record) {
+    if (parsePath(fileName, record) == false) {
+        const QFileInfo fileInfo(fileName);
+        record.event = fileInfo.dir().dirName();
+        record.station = fileInfo.completeBaseName();
+        record.component.clear();
+    }
+}
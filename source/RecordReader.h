@@ -0,0 +1,158 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef RECORD_READER_H_
+#define RECORD_READER_H_
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*! TextCursor parses text in memory, such as a mapped file, without
+ * allocating. Numbers are parsed in the C locale and may use a D exponent.
+ */
+class TextCursor {
+public:
+    TextCursor(const char *begin, const char *end);
+
+    bool atEnd() const;
+
+    /*! Next line without the line ending.
+     * \return false at the end of the text
+     */
+    bool readLine(const char **begin, const char **end);
+
+    //! Next line as a copy -- used for the header lines
+    QString readLine();
+
+    //! Skip the remainder of the current line and a number of full lines
+    void skipLines(int count);
+
+    //! Next number separated by white space or commas
+    bool readDouble(double *value);
+
+    /*! Next number in a fixed width field. Fields do not continue across line
+     * breaks and blank fields at the end of a line are skipped.
+     */
+    bool readField(int width, double *value);
+
+    //! Parse a number from the text, surrounding white space is ignored
+    static bool toDouble(const char *begin, const char *end, double *value);
+
+private:
+    const char *m_pos;
+
+    const char *m_end;
+
+    //! Start of the text
+    const char *m_begin;
+};
+
+/*! RecordReader reads the acceleration and metadata of a record in a
+ * particular file format.
+ *
+ * The readers are kept in a registry. The reader of a file is selected by the
+ * name filters and confirmed by sniffing the start of the file, which is
+ * sniffed by every reader if the reader of the extension does not recognize
+ * it. Files are mapped into memory and every reader parses the mapped text
+ * with TextCursor.
+ *
+ * Additional readers, such as the two column reader, are added with add()
+ * before the motions are read.
+ */
+class RecordReader {
+public:
+    //! Metadata and acceleration of a record
+    struct Record {
+        Record();
+
+        QString event;
+        QString station;
+        QString component;
+        QString details;
+
+        //! Time step (sec)
+        double dt;
+
+        //! Acceleration in g
+        QVector<double> acc;
+    };
+
+    virtual ~RecordReader();
+
+    //! Name of the format
+    virtual QString name() const = 0;
+
+    //! Wildcard filters of the file names, e.g. "*.at2"
+    virtual QStringList nameFilters() const = 0;
+
+    //! Check if the start of a file is in the format
+    virtual bool sniff(const char *begin, const char *end) const = 0;
+
+    /*! Read a record.
+     * \param fileName name of the file, used for the metadata
+     * \param begin start of the contents of the file
+     * \param end end of the contents of the file
+     * \param record record read
+     * \return false if the file is not a valid record
+     */
+    virtual bool read(const QString &fileName, const char *begin, const char *end,
+                      Record &record) const = 0;
+
+    //! Add a reader to the registry, which takes ownership
+    static void add(RecordReader *reader);
+
+    /*! Reader of two columns of time and acceleration (g). The reader is not
+     * registered by default as its extensions (*.txt and *.dat) are generic.
+     */
+    static RecordReader *createTwoColumnReader();
+
+    //! Readers in the registry
+    static const QList<RecordReader *> &readers();
+
+    //! Name filters of all of the readers in both cases
+    static QStringList allNameFilters();
+
+    //! Select the reader of a file, returns null if none recognizes the contents
+    static const RecordReader *find(const QString &fileName, const char *begin, const char *end);
+
+    /*! Map a file into memory and read it with the selected reader. Failures
+     * are not reported, so that the caller reports them once.
+     * \return false if the file cannot be opened or is not a valid record
+     */
+    static bool readFile(const QString &fileName, Record &record);
+
+protected:
+    /*! Determine the event, station, and component from the file name
+     * following the '<EVENT>/<STATION><COMPONENT>.<EXT>' convention of PEER.
+     * \return false if the name does not follow the convention
+     */
+    static bool parsePath(const QString &fileName, Record &record);
+
+    /*! Determine the metadata with parsePath(), or use the directory as the
+     * event and the base name of the file as the station otherwise.
+     */
+    static void parseName(const QString &fileName, Record &record);
+
+private:
+    static QList<RecordReader *> &registry();
+};
+
+#endif
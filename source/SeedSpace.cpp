@@ -0,0 +1,252 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#include "SeedSpace.h"
+
+#include <QHash>
+
+#include <limits>
+
+namespace {
+    const quint64 Saturated = std::numeric_limits<quint64>::max();
+
+    quint64 addSat(quint64 a, quint64 b) {
+        return (a > Saturated - b) ? Saturated : a + b;
+    }
+
+    quint64 mulSat(quint64 a, quint64 b) {
+        return (a != 0 && b > Saturated / a) ? Saturated : a * b;
+    }
+
+    quint64 gcd(quint64 a, quint64 b) {
+        while (b) {
+            const quint64 t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    }
+}
+
+SeedSpace::SeedSpace()
+        : m_seedSize(0), m_overflow(false) {
+}
+
+void SeedSpace::reset(const QVector<int> &groups, int seedSize) {
+    m_seedSize = qMax(0, seedSize);
+    m_members.clear();
+    m_groupOf.resize(groups.size());
+    m_memberOf.resize(groups.size());
+
+    // Order the groups by the first candidate
+    QHash<int, int> index;
+    for (int i = 0; i < groups.size(); ++i) {
+        if (index.contains(groups.at(i)) == false) {
+            index.insert(groups.at(i), m_members.size());
+            m_members << QVector<int>();
+        }
+        const int g = index.value(groups.at(i));
+        m_groupOf[i] = g;
+        m_memberOf[i] = m_members.at(g).size();
+        m_members[g] << i;
+    }
+
+    // Number of completions from each suffix of the groups:
+    //   E(g, r) = E(g + 1, r) + size(g) * E(g + 1, r - 1)
+    const int groupCount = m_members.size();
+    const int width = m_seedSize + 1;
+    m_suffix.fill(0, (groupCount + 1) * width);
+    m_approxSuffix.fill(0, (groupCount + 1) * width);
+
+    m_suffix[groupCount * width] = 1;
+    m_approxSuffix[groupCount * width] = 1;
+
+    for (int g = groupCount - 1; g >= 0; --g) {
+        const quint64 size = m_members.at(g).size();
+        m_suffix[g * width] = 1;
+        m_approxSuffix[g * width] = 1;
+
+        for (int r = 1; r <= m_seedSize; ++r) {
+            m_suffix[g * width + r] = addSat(suffix(g + 1, r),
+                                             mulSat(size, suffix(g + 1, r - 1)));
+            m_approxSuffix[g * width + r] = approxSuffix(g + 1, r)
+                                            + size * approxSuffix(g + 1, r - 1);
+        }
+    }
+
+    // Only the count needs to be checked, as the completions of any prefix
+    // are a subset of all of the seeds
+    m_overflow = (suffix(0, m_seedSize) == Saturated);
+}
+
+bool SeedSpace::isValid() const {
+    return m_seedSize > 0 && approxCount() > 0;
+}
+
+int SeedSpace::seedSize() const {
+    return m_seedSize;
+}
+
+bool SeedSpace::contains(const QVector<int> &seed) const {
+    if (seed.size() != m_seedSize) {
+        return false;
+    }
+
+    // The motions are in increasing order of the groups
+    int g = -1;
+    for (int i : seed) {
+        if (i < 0 || i >= m_groupOf.size() || m_groupOf.at(i) <= g) {
+            return false;
+        }
+        g = m_groupOf.at(i);
+    }
+    return true;
+}
+
+bool SeedSpace::isOverflow() const {
+    return m_overflow;
+}
+
+quint64 SeedSpace::count() const {
+    return m_suffix.isEmpty() ? 0 : suffix(0, m_seedSize);
+}
+
+double SeedSpace::approxCount() const {
+    return m_approxSuffix.isEmpty() ? 0 : approxSuffix(0, m_seedSize);
+}
+
+quint64 SeedSpace::suffix(int g, int r) const {
+    return m_suffix.at(g * (m_seedSize + 1) + r);
+}
+
+double SeedSpace::approxSuffix(int g, int r) const {
+    return m_approxSuffix.at(g * (m_seedSize + 1) + r);
+}
+
+void SeedSpace::unrank(quint64 rank, QVector<int> &seed) const {
+    Q_ASSERT(!m_overflow && rank < count());
+
+    seed.resize(m_seedSize);
+
+    int g = 0;
+    for (int p = 0; p < m_seedSize; ++p) {
+        const int remaining = m_seedSize - p - 1;
+
+        for (int s = g; s < m_members.size(); ++s) {
+            const quint64 completions = suffix(s + 1, remaining);
+            const quint64 block = m_members.at(s).size() * completions;
+
+            if (rank < block) {
+                seed[p] = m_members.at(s).at(int(rank / completions));
+                rank %= completions;
+                g = s + 1;
+                break;
+            }
+            rank -= block;
+        }
+    }
+}
+
+quint64 SeedSpace::rank(const QVector<int> &seed) const {
+    Q_ASSERT(!m_overflow);
+
+    quint64 rank = 0;
+    int g = 0;
+    for (int p = 0; p < seed.size(); ++p) {
+        const int remaining = m_seedSize - p - 1;
+        const int s = m_groupOf.at(seed.at(p));
+
+        for (int t = g; t < s; ++t) {
+            rank += m_members.at(t).size() * suffix(t + 1, remaining);
+        }
+        rank += m_memberOf.at(seed.at(p)) * suffix(s + 1, remaining);
+        g = s + 1;
+    }
+
+    return rank;
+}
+
+void SeedSpace::first(QVector<int> &seed) const {
+    seed.resize(m_seedSize);
+    for (int p = 0; p < m_seedSize; ++p) {
+        seed[p] = m_members.at(p).first();
+    }
+}
+
+bool SeedSpace::next(QVector<int> &seed) const {
+    const int groupCount = m_members.size();
+
+    for (int p = m_seedSize - 1; p >= 0; --p) {
+        int s = m_groupOf.at(seed.at(p));
+        const int m = m_memberOf.at(seed.at(p));
+
+        if (m + 1 < m_members.at(s).size()) {
+            // Next member of the same group
+            seed[p] = m_members.at(s).at(m + 1);
+        } else if (s + 1 + (m_seedSize - p - 1) < groupCount) {
+            // First member of the next group
+            ++s;
+            seed[p] = m_members.at(s).first();
+        } else {
+            continue;
+        }
+
+        // Reset the remaining positions to the first members of the
+        // following groups
+        for (int q = p + 1; q < m_seedSize; ++q) {
+            seed[q] = m_members.at(s + q - p).first();
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void SeedSpace::chunk(int index, int chunkCount, quint64 *begin, quint64 *end) const {
+    const quint64 total = count();
+    const quint64 size = total / chunkCount;
+    const quint64 extra = total % chunkCount;
+    const quint64 i = index;
+
+    *begin = i * size + qMin(i, extra);
+    *end = *begin + size + (i < extra ? 1 : 0);
+}
+
+quint64 SeedSpace::binomial(int n, int k, bool *overflow) {
+    *overflow = false;
+    if (k < 0 || k > n) {
+        return 0;
+    }
+    k = qMin(k, n - k);
+
+    quint64 r = 1;
+    for (int i = 1; i <= k; ++i) {
+        // r * (n - k + i) / i is an integer, so divide by the common factor
+        // first to avoid overflow of the intermediate product
+        const quint64 g = gcd(r, quint64(i));
+        r /= g;
+        const quint64 t = quint64(n - k + i) / (quint64(i) / g);
+        if (r > Saturated / t) {
+            *overflow = true;
+            return Saturated;
+        }
+        r *= t;
+    }
+
+    return r;
+}
@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SEED_SPACE_H_
+#define SEED_SPACE_H_
+
+#include <QVector>
+#include <QtGlobal>
+
+/*! SeedSpace enumerates, counts, and ranks the seed combinations.
+ *
+ * The candidate motions are divided into groups and a seed contains at most
+ * one motion from each group. With one motion per station the groups are the
+ * stations, otherwise each motion is a group of its own and the seeds are the
+ * plain combinations of the candidates.
+ *
+ * The seeds are ordered lexicographically by (group, member) of each
+ * position. The number of seeds is the elementary symmetric polynomial of the
+ * group sizes, which is computed exactly with 64-bit integers. If the count
+ * overflows, the seeds can still be enumerated with next(), but ranking is not
+ * available and only an approximate count is provided.
+ */
+class SeedSpace {
+public:
+    SeedSpace();
+
+    /*! Define the space.
+     * \param groups group of each candidate motion
+     * \param seedSize number of motions in a seed
+     */
+    void reset(const QVector<int> &groups, int seedSize);
+
+    //! Number of motions in each seed
+    int seedSize() const;
+
+    //! If the seed belongs to the space -- used to check loaded seeds
+    bool contains(const QVector<int> &seed) const;
+
+    //! If at least one seed exists
+    bool isValid() const;
+
+    //! If the exact count exceeds 64 bits
+    bool isOverflow() const;
+
+    //! Exact number of seeds, valid if there is no overflow
+    quint64 count() const;
+
+    //! Number of seeds in floating point, available even with overflow
+    double approxCount() const;
+
+    /*! The seed at the rank.
+     * \param rank rank of the seed, less than count()
+     * \param seed indices of the candidates in the seed
+     */
+    void unrank(quint64 rank, QVector<int> &seed) const;
+
+    //! Rank of a seed -- the inverse of unrank()
+    quint64 rank(const QVector<int> &seed) const;
+
+    //! First seed
+    void first(QVector<int> &seed) const;
+
+    /*! Advance to the next seed.
+     * \return false if the seed was the last
+     */
+    bool next(QVector<int> &seed) const;
+
+    /*! Split the seeds into equal chunks.
+     * \param index index of the chunk
+     * \param chunkCount number of chunks
+     * \param begin rank of the first seed in the chunk
+     * \param end rank after the last seed in the chunk
+     */
+    void chunk(int index, int chunkCount, quint64 *begin, quint64 *end) const;
+
+    //! Exact binomial coefficient, sets overflow if it exceeds 64 bits
+    static quint64 binomial(int n, int k, bool *overflow);
+
+private:
+    //! Number of ways to complete r positions from the groups starting at g
+    quint64 suffix(int g, int r) const;
+
+    double approxSuffix(int g, int r) const;
+
+    int m_seedSize;
+
+    //! Candidate indices of each group
+    QVector<QVector<int>> m_members;
+
+    //! Group and position within the group of each candidate
+    QVector<int> m_groupOf;
+    QVector<int> m_memberOf;
+
+    //! Elementary symmetric polynomials of the group sizes of the suffixes
+    //! stored as (group count + 1) x (seed size + 1)
+    QVector<quint64> m_suffix;
+    QVector<double> m_approxSuffix;
+
+    bool m_overflow;
+};
+
+#endif
@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#include "SelectionCheckpoint.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QtDebug>
+
+namespace {
+    //! Version of the file format
+    const int Version = 1;
+
+    QJsonArray toArray(const QVector<int> &indices) {
+        QJsonArray array;
+        for (int i : indices) {
+            array << i;
+        }
+        return array;
+    }
+
+    QVector<int> fromArray(const QJsonArray &array) {
+        QVector<int> indices;
+        indices.reserve(array.size());
+        for (const QJsonValue &value : array) {
+            indices << value.toInt(-1);
+        }
+        return indices;
+    }
+}
+
+SelectionCheckpoint::SelectionCheckpoint()
+        : count(0), finished(false) {
+}
+
+bool SelectionCheckpoint::save(const QString &fileName) const {
+    QJsonArray targets;
+    for (const QList<QVector<int>> &list : suites) {
+        QJsonArray array;
+        for (const QVector<int> &suite : list) {
+            array << toArray(suite);
+        }
+        targets << array;
+    }
+
+    QJsonObject root;
+    root["version"] = Version;
+    root["fingerprint"] = fingerprint;
+    root["configuration"] = configuration;
+    // JSON numbers are doubles, so the count is saved as text to keep it exact
+    root["count"] = QString::number(count);
+    root["finished"] = finished;
+    root["seed"] = toArray(seed);
+    root["suites"] = targets;
+
+    QSaveFile file(fileName);
+    if (file.open(QIODevice::WriteOnly) == false) {
+        qCritical() << "Unable to open file:" << fileName;
+        return false;
+    }
+
+    file.write(QJsonDocument(root).toJson());
+
+    if (file.commit() == false) {
+        qCritical() << "Unable to write to file:" << fileName;
+        return false;
+    }
+
+    return true;
+}
+
+bool SelectionCheckpoint::load(const QString &fileName) {
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly) == false) {
+        qCritical() << "Unable to open file:" << fileName;
+        return false;
+    }
+
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    const QJsonObject root = doc.object();
+
+    bool ok = false;
+    if (error.error == QJsonParseError::NoError && root.value("version").toInt() == Version) {
+        count = root.value("count").toString().toULongLong(&ok);
+    }
+
+    if (ok == false) {
+        qCritical() << "Not a selection checkpoint:" << fileName;
+        return false;
+    }
+
+    fingerprint = root.value("fingerprint").toString();
+    configuration = root.value("configuration").toObject();
+    finished = root.value("finished").toBool();
+    seed = fromArray(root.value("seed").toArray());
+
+    suites.clear();
+    for (const QJsonValue &target : root.value("suites").toArray()) {
+        QList<QVector<int>> list;
+        for (const QJsonValue &suite : target.toArray()) {
+            list << fromArray(suite.toArray());
+        }
+        suites << list;
+    }
+
+    return true;
+}
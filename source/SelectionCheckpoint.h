@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SELECTION_CHECKPOINT_H_
+#define SELECTION_CHECKPOINT_H_
+
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+/*! SelectionCheckpoint is the state of a suite selection saved to disk.
+ *
+ * The checkpoint records the position in the seed enumeration and the saved
+ * suites of each target as indices of the candidate motions. The candidates
+ * are only meaningful for the same motions, filter, and settings, so the run
+ * configuration and a fingerprint of it are stored as well. The file is JSON
+ * and is replaced atomically, so an interrupted write leaves the previous
+ * checkpoint intact.
+ */
+struct SelectionCheckpoint {
+    SelectionCheckpoint();
+
+    /*! Save the checkpoint.
+     * \param fileName name of the file
+     * \return true if the file was written
+     */
+    bool save(const QString &fileName) const;
+
+    /*! Load a checkpoint.
+     * \param fileName name of the file
+     * \return true if the file is a valid checkpoint
+     */
+    bool load(const QString &fileName);
+
+    //! Hash of the run configuration, candidates, and targets
+    QString fingerprint;
+
+    //! Readable description of the run configuration
+    QJsonObject configuration;
+
+    //! Next seed to evaluate as indices of the candidates
+    QVector<int> seed;
+
+    //! Number of seeds already evaluated
+    quint64 count;
+
+    //! If all of the seeds have been evaluated
+    bool finished;
+
+    //! Motions of the saved suites of each target as indices of the candidates
+    QVector<QList<QVector<int>>> suites;
+};
+
+#endif
@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "SigmaFit.h"
+
+#include <cmath>
+
+SigmaFit::SigmaFit(const QVector<double> &targetLnSa, const QVector<double> &targetLnStd)
+        : m_targetLnSa(targetLnSa), m_targetLnStd(targetLnStd), m_motionCount(0) {
+}
+
+void SigmaFit::setMotions(const QList<AbstractMotion *> &motions,
+                          const QVector<double> &centroids) {
+    const int periodCount = m_targetLnSa.size();
+    m_motionCount = motions.size();
+
+    m_block.resize(periodCount * m_motionCount);
+    m_offset.resize(m_motionCount);
+    m_slope.resize(m_motionCount);
+    m_lnScalars.resize(m_motionCount);
+
+    double meanLnSa = 0;
+    double meanLnStd = 0;
+    for (int j = 0; j < periodCount; ++j) {
+        meanLnSa += m_targetLnSa.at(j);
+        meanLnStd += m_targetLnStd.at(j);
+    }
+    meanLnSa /= periodCount;
+    meanLnStd /= periodCount;
+
+    // The log of the scale factor is the mean difference between the fractile
+    // and the motion:
+    //   mean(lnSa) + sigmaScalar * centroid * mean(lnStd) - mean(motion lnSa)
+    for (int i = 0; i < m_motionCount; ++i) {
+        const double *lnSa = motions.at(i)->lnSa().constData();
+        double mean = 0;
+        for (int j = 0; j < periodCount; ++j) {
+            m_block[j * m_motionCount + i] = lnSa[j];
+            mean += lnSa[j];
+        }
+        m_offset[i] = meanLnSa - mean / periodCount;
+        m_slope[i] = centroids.at(i) * meanLnStd;
+    }
+}
+
+double SigmaFit::error(double sigmaScalar, double *lnScalars, double *lnAvg,
+                       double *lnStd) const {
+    const int n = m_motionCount;
+    const int periodCount = m_targetLnSa.size();
+
+    double *scalars = m_lnScalars.data();
+    for (int i = 0; i < n; ++i) {
+        scalars[i] = m_offset.at(i) + sigmaScalar * m_slope.at(i);
+    }
+
+    double sse = 0;
+    const double *row = m_block.constData();
+    for (int j = 0; j < periodCount; ++j, row += n) {
+        double sum = 0;
+        for (int i = 0; i < n; ++i) {
+            sum += row[i] + scalars[i];
+        }
+        const double avg = sum / n;
+
+        // The probability of each motion is equal
+        double var = 0;
+        for (int i = 0; i < n; ++i) {
+            const double d = row[i] + scalars[i] - avg;
+            var += d * d;
+        }
+        const double stdev = sqrt(var / (n - 1));
+
+        const double d = stdev - m_targetLnStd.at(j);
+        sse += d * d;
+
+        if (lnAvg) {
+            lnAvg[j] = avg;
+        }
+        if (lnStd) {
+            lnStd[j] = stdev;
+        }
+    }
+
+    if (lnScalars) {
+        for (int i = 0; i < n; ++i) {
+            lnScalars[i] = scalars[i];
+        }
+    }
+
+    // Root mean square error
+    return sqrt(sse / periodCount);
+}
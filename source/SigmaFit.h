@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef SIGMA_FIT_H_
+#define SIGMA_FIT_H_
+
+#include "AbstractMotion.h"
+
+#include <QList>
+#include <QVector>
+
+/*! SigmaFit evaluates the fit of the standard deviation of a scaled suite.
+ *
+ * Each motion is scaled to the fractile at its centroid, which makes the log
+ * of the scale factor linear in the factor applied to the target standard
+ * deviation. The spectra are copied into a block stored period by period and
+ * the terms that do not depend on the factor are computed in setMotions(), so
+ * that error() is a short pass over the block that does not allocate.
+ */
+class SigmaFit {
+public:
+    SigmaFit(const QVector<double> &targetLnSa, const QVector<double> &targetLnStd);
+
+    /*! Set the motions of the suite.
+     * \param motions motions of the suite
+     * \param centroids fractile of each motion of the standard normal distribution
+     */
+    void setMotions(const QList<AbstractMotion *> &motions, const QVector<double> &centroids);
+
+    /*! Root mean square error of the standard deviation.
+     * \param sigmaScalar factor applied to the target standard deviation
+     * \param lnScalars if provided, the log of the scale factor of each motion
+     * \param lnAvg if provided, the natural log of the average of the scaled suite
+     * \param lnStd if provided, the standard deviation of the scaled suite
+     */
+    double error(double sigmaScalar, double *lnScalars = 0, double *lnAvg = 0,
+                 double *lnStd = 0) const;
+
+private:
+    const QVector<double> &m_targetLnSa;
+    const QVector<double> &m_targetLnStd;
+
+    int m_motionCount;
+
+    //! Natural log of the spectral acceleration as period count x motion count
+    QVector<double> m_block;
+
+    //! Log of the scale factor without the standard deviation term
+    QVector<double> m_offset;
+
+    //! Centroid multiplied by the mean target standard deviation
+    QVector<double> m_slope;
+
+    //! Log of the scale factors of the current evaluation
+    mutable QVector<double> m_lnScalars;
+};
+
+#endif
@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#include "SpectralContext.h"
+
+#include <cmath>
+
+namespace {
+    //! Number of master periods
+    const int MasterCount = 300;
+
+    //! Range of the master periods
+    const double MasterMin = 0.01;
+    const double MasterMax = 20.;
+
+    //! Tolerance on the range to allow for rounding of the user periods
+    const double MasterTol = 1e-6;
+}
+
+SpectralContext::SpectralContext(const QVector<double> &period, double damping)
+        : m_period(period), m_damping(damping) {
+    bool inside = !m_period.isEmpty();
+    for (double p : m_period) {
+        if (p < MasterMin * (1 - MasterTol) || p > MasterMax * (1 + MasterTol)) {
+            inside = false;
+            break;
+        }
+    }
+
+    if (inside) {
+        // The master periods are evenly spaced in log space, so the location
+        // of each period is computed directly.
+        const double lnMin = log(MasterMin);
+        const double lnDelta = (log(MasterMax) - lnMin) / (MasterCount - 1);
+
+        m_masterIndex.resize(m_period.size());
+        m_masterWeight.resize(m_period.size());
+
+        for (int i = 0; i < m_period.size(); ++i) {
+            const double x = (log(m_period.at(i)) - lnMin) / lnDelta;
+            const int j = qBound(0, int(floor(x)), MasterCount - 2);
+
+            m_masterIndex[i] = j;
+            m_masterWeight[i] = qBound(0., x - j, 1.);
+        }
+    }
+}
+
+const QVector<double> &SpectralContext::period() const {
+    return m_period;
+}
+
+double SpectralContext::damping() const {
+    return m_damping;
+}
+
+bool SpectralContext::isEquivalent(const SpectralContext &other) const {
+    return m_damping == other.m_damping && m_period == other.m_period;
+}
+
+const QVector<double> &SpectralContext::masterPeriod() {
+    static const QVector<double> period = [] {
+        QVector<double> values(MasterCount);
+        const double lnMin = log(MasterMin);
+        const double lnDelta = (log(MasterMax) - lnMin) / (MasterCount - 1);
+
+        for (int i = 0; i < values.size(); ++i) {
+            values[i] = exp(lnMin + i * lnDelta);
+        }
+        return values;
+    }();
+
+    return period;
+}
+
+bool SpectralContext::isWithinMaster() const {
+    return !m_masterIndex.isEmpty();
+}
+
+bool SpectralContext::canResampleTo(const SpectralContext &other) const {
+    return m_damping == other.m_damping && isWithinMaster() && other.isWithinMaster();
+}
+
+void SpectralContext::interpMaster(const QVector<double> &master, QVector<double> &values) const {
+    Q_ASSERT(isWithinMaster() && master.size() == MasterCount);
+
+    values.resize(m_period.size());
+    for (int i = 0; i < m_period.size(); ++i) {
+        const int j = m_masterIndex.at(i);
+        const double w = m_masterWeight.at(i);
+        values[i] = (1 - w) * master.at(j) + w * master.at(j + 1);
+    }
+}
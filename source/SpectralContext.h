@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SPECTRAL_CONTEXT_H_
+#define SPECTRAL_CONTEXT_H_
+
+#include <QSharedPointer>
+#include <QVector>
+
+/*! SpectralContext describes the oscillators used to compute the response
+ * spectra: the natural periods and the damping.
+ *
+ * A context is immutable once it has been created. Each motion keeps a shared
+ * reference to the context that its response spectrum was computed with, so
+ * that separate libraries can use different periods or damping in the same
+ * process.
+ *
+ * The response spectrum of each motion is computed once at the dense master
+ * periods (see masterPeriod()). Any context with periods inside the range of
+ * the master periods is then derived by log-log interpolation, so that
+ * changing the periods does not require the motions to be processed again.
+ */
+class SpectralContext {
+public:
+    /*!
+     * \param period natural periods of the oscillators
+     * \param damping damping of the oscillators in decimal
+     */
+    SpectralContext(const QVector<double> &period, double damping);
+
+    //! Natural periods of the oscillators
+    const QVector<double> &period() const;
+
+    //! Damping of the oscillators in decimal
+    double damping() const;
+
+    //! Check if the two contexts describe the same oscillators
+    bool isEquivalent(const SpectralContext &other) const;
+
+    //! Dense log-spaced periods at which the motions are computed
+    static const QVector<double> &masterPeriod();
+
+    //! Check if the periods are inside the range of the master periods
+    bool isWithinMaster() const;
+
+    /*! Check if spectra computed with this context can be interpolated onto
+     * the other context without processing the motions again.
+     */
+    bool canResampleTo(const SpectralContext &other) const;
+
+    /*! Interpolate values defined at the master periods onto the periods of
+     * the context. The interpolation is linear in log period, so a log
+     * response spectrum is interpolated in log-log space.
+     * \param master values at each of the master periods
+     * \param values values at each of the periods
+     */
+    void interpMaster(const QVector<double> &master, QVector<double> &values) const;
+
+private:
+    //! Period of the response spectrum
+    const QVector<double> m_period;
+
+    //! Damping of the response spectrum
+    const double m_damping;
+
+    //! Master period index below each period -- empty if outside of the master
+    QVector<int> m_masterIndex;
+
+    //! Interpolation weight of the master period above each period
+    QVector<double> m_masterWeight;
+};
+
+typedef QSharedPointer<const SpectralContext> SpectralContextPtr;
+
+#endif
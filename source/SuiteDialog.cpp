@@ -24,6 +24,7 @@
 #include "ExportDialog.h"
 
 #include "MotionPair.h"
+#include "TimeSeriesCurve.h"
 
 #include <QApplication>
 #include <QClipboard>
@@ -94,7 +95,11 @@ void SuiteDialog::suiteSelected() {
 
 
 QwtPlotCurve *SuiteDialog::createCurve(QwtPlot *plot, QString key, QPen pen, double zOrder) {
-    QwtPlotCurve *curve = new QwtPlotCurve;
+    return createCurve(new QwtPlotCurve, plot, key, pen, zOrder);
+}
+
+QwtPlotCurve *SuiteDialog::createCurve(QwtPlotCurve *curve, QwtPlot *plot, QString key, QPen pen,
+                                       double zOrder) {
     curve->setPen(pen);
     curve->setZ(zOrder);
     curve->setRenderHint(QwtPlotItem::RenderAntialiased);
@@ -137,9 +142,9 @@ void SuiteDialog::motionSelected() {
 
     // Set the data -- QMap with the same key is sorted from most recently to least recently inserted.
     QList<QwtPlotCurve *> curves = m_curves.values("timeSeries");
-    curves.at(0)->setSamples(motion->time(), motion->disp());
-    curves.at(1)->setSamples(motion->time(), motion->vel());
-    curves.at(2)->setSamples(motion->time(), motion->acc());
+    static_cast<TimeSeriesCurve *>(curves.at(0))->setSeries(motion->time(), motion->disp());
+    static_cast<TimeSeriesCurve *>(curves.at(1))->setSeries(motion->time(), motion->vel());
+    static_cast<TimeSeriesCurve *>(curves.at(2))->setSeries(motion->time(), motion->acc());
 }
 
 void SuiteDialog::showTimeHistoryTab() {
@@ -504,7 +509,9 @@ void SuiteDialog::createTabWidget() {
         plot = createPlot(xLabel, false, yLabel, false, true);
         plot->axisScaleEngine(QwtPlot::yLeft)
                 ->setAttribute(QwtScaleEngine::Symmetric, true);
-        createCurve(plot, "timeSeries", QPen(Qt::blue));
+        // The time series are shared with the motion and decimated to the
+        // width of the plot
+        createCurve(new TimeSeriesCurve, plot, "timeSeries", QPen(Qt::blue));
         layout->addWidget(plot);
     }
 
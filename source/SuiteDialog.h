@@ -78,6 +78,10 @@ protected:
     //! Create a curve and add it to the collection
     QwtPlotCurve *createCurve(QwtPlot *plot, QString key, QPen pen, double zOrder = 20);
 
+    //! Set up a curve, e.g. a TimeSeriesCurve, and add it to the collection
+    QwtPlotCurve *createCurve(QwtPlotCurve *curve, QwtPlot *plot, QString key, QPen pen,
+                              double zOrder = 20);
+
     //! Helper function to create a plot and connect it with the widget
     QwtPlot *createPlot(const QString &xLabel = "",
                         bool xLogAxis = false,
@@ -0,0 +1,702 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#include "SuiteWriter.h"
+#include "PackedLibrary.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QRunnable>
+#include <QStringList>
+#include <QThreadPool>
+#include <QtDebug>
+#include <QtEndian>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+    //! Append a number in the format of QTextStream
+    inline void appendNumber(QByteArray &out, double value) {
+        out += QByteArray::number(value, 'g', 6);
+    }
+
+    //! Append a number with a fixed number of decimals
+    inline void appendFixed(QByteArray &out, double value, int precision) {
+        out += QByteArray::number(value, 'f', precision);
+    }
+
+    //! CRC-32 used by the zip format
+    quint32 crc32(const QByteArray &data) {
+        static const QVector<quint32> table = [] {
+            QVector<quint32> t(256);
+            for (quint32 i = 0; i < 256; ++i) {
+                quint32 c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[i] = c;
+            }
+            return t;
+        }();
+
+        quint32 crc = 0xFFFFFFFFu;
+        for (const char c : data) {
+            crc = table.at((crc ^ quint8(c)) & 0xFF) ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    //! Array in the NumPy format (.npy version 1.0)
+    class NpyArray {
+    public:
+        /*! Start an array.
+         * \param descr NumPy type, e.g. "<f8"
+         * \param shape dimensions of the array
+         * \param itemSize size of an element in bytes
+         */
+        NpyArray(const QByteArray &descr, const QVector<int> &shape, int itemSize) {
+            QByteArray dims;
+            int count = 1;
+            for (int n : shape) {
+                dims += QByteArray::number(n) + ',';
+                count *= n;
+            }
+            if (shape.size() > 1) {
+                dims.chop(1);
+            }
+
+            QByteArray header = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': ("
+                                + dims + "), }";
+            // The data is aligned to 64 bytes and the header ends with a newline
+            const int padding = 63 - (10 + header.size()) % 64;
+            header += QByteArray(padding, ' ') + '\n';
+
+            m_data.reserve(10 + header.size() + count * itemSize);
+            m_data += "\x93NUMPY";
+            m_data += char(1);
+            m_data += char(0);
+            m_data += char(header.size() & 0xFF);
+            m_data += char(header.size() >> 8);
+            m_data += header;
+        }
+
+        void append(double value) {
+            quint64 bits;
+            memcpy(&bits, &value, sizeof(bits));
+            uchar bytes[8];
+            qToLittleEndian<quint64>(bits, bytes);
+            m_data.append(reinterpret_cast<const char *>(bytes), 8);
+        }
+
+        //! Append a string padded to the number of characters as UTF-32
+        void append(const QString &value, int length) {
+            const QVector<uint> ucs4 = value.toUcs4();
+            uchar bytes[4];
+            for (int i = 0; i < length; ++i) {
+                qToLittleEndian<quint32>(i < ucs4.size() ? ucs4.at(i) : 0, bytes);
+                m_data.append(reinterpret_cast<const char *>(bytes), 4);
+            }
+        }
+
+        const QByteArray &data() const {
+            return m_data;
+        }
+
+    private:
+        QByteArray m_data;
+    };
+
+    //! Zip archive of uncompressed entries
+    class ZipArchive {
+    public:
+        ZipArchive() {
+            const QDateTime now = QDateTime::currentDateTime();
+            const QDate date = now.date();
+            const QTime time = now.time();
+            m_date = quint16(((date.year() - 1980) << 9) | (date.month() << 5) | date.day());
+            m_time = quint16((time.hour() << 11) | (time.minute() << 5) | (time.second() / 2));
+        }
+
+        void add(const QByteArray &name, const QByteArray &data) {
+            const quint32 crc = crc32(data);
+            const quint32 offset = quint32(m_data.size());
+
+            // Local file header
+            appendU32(m_data, 0x04034b50);
+            appendEntry(m_data, name, data, crc);
+            m_data += name;
+            m_data += data;
+
+            // Entry of the central directory
+            appendU32(m_directory, 0x02014b50);
+            appendU16(m_directory, 20);
+            appendEntry(m_directory, name, data, crc);
+            appendU16(m_directory, 0); // comment length
+            appendU16(m_directory, 0); // disk number
+            appendU16(m_directory, 0); // internal attributes
+            appendU32(m_directory, 0); // external attributes
+            appendU32(m_directory, offset);
+            m_directory += name;
+
+            ++m_count;
+        }
+
+        QByteArray finish() {
+            const quint32 offset = quint32(m_data.size());
+            m_data += m_directory;
+
+            // End of the central directory
+            appendU32(m_data, 0x06054b50);
+            appendU16(m_data, 0);
+            appendU16(m_data, 0);
+            appendU16(m_data, m_count);
+            appendU16(m_data, m_count);
+            appendU32(m_data, quint32(m_directory.size()));
+            appendU32(m_data, offset);
+            appendU16(m_data, 0);
+
+            return m_data;
+        }
+
+    private:
+        static void appendU16(QByteArray &out, quint16 value) {
+            uchar bytes[2];
+            qToLittleEndian<quint16>(value, bytes);
+            out.append(reinterpret_cast<const char *>(bytes), 2);
+        }
+
+        static void appendU32(QByteArray &out, quint32 value) {
+            uchar bytes[4];
+            qToLittleEndian<quint32>(value, bytes);
+            out.append(reinterpret_cast<const char *>(bytes), 4);
+        }
+
+        //! Fields shared by the local header and the central directory
+        void appendEntry(QByteArray &out, const QByteArray &name, const QByteArray &data,
+                         quint32 crc) const {
+            appendU16(out, 20); // version needed
+            appendU16(out, 0); // flags
+            appendU16(out, 0); // stored
+            appendU16(out, m_time);
+            appendU16(out, m_date);
+            appendU32(out, crc);
+            appendU32(out, quint32(data.size()));
+            appendU32(out, quint32(data.size()));
+            appendU16(out, quint16(name.size()));
+            appendU16(out, 0); // extra length
+        }
+
+        QByteArray m_data;
+        QByteArray m_directory;
+        quint16 m_count = 0;
+        quint16 m_time;
+        quint16 m_date;
+    };
+
+    /*! Write a text buffer to a file without reporting the failure. The file
+     * is opened in text mode, so binary data must be written with QFile.
+     * \param fileName name of the file
+     * \param data contents of the file
+     * \param error set to the reason of the failure
+     * \return true if the file was written
+     */
+    bool writeText(const QString &fileName, const QByteArray &data, QString *error) {
+        QFile file(fileName);
+
+        if (file.open(QIODevice::WriteOnly | QIODevice::Text) == false) {
+            *error = QString("Unable to open file: %1").arg(fileName);
+            return false;
+        }
+
+        if (file.write(data) != data.size()) {
+            *error = QString("Unable to write to file: %1").arg(fileName);
+            return false;
+        }
+
+        return true;
+    }
+
+    //! Failures of the jobs, reported once the pool has finished
+    class Failures {
+    public:
+        void add(const QString &error) {
+            QMutexLocker locker(&m_mutex);
+            m_errors << error;
+        }
+
+        bool isEmpty() const {
+            return m_errors.isEmpty();
+        }
+
+        //! Report the failures on the calling thread
+        void report() const {
+            qCritical() << qPrintable(m_errors.join("\n"));
+        }
+
+    private:
+        QMutex m_mutex;
+        QStringList m_errors;
+    };
+
+    //! Format and write a suite on a worker thread
+    class WriteJob : public QRunnable {
+    public:
+        WriteJob(const MotionSuite *suite, const QString &fileName, MotionSuite::OutputType type,
+                 Failures *failures)
+                : m_suite(suite), m_fileName(fileName), m_type(type), m_failures(failures) {
+        }
+
+        void run() {
+            QString error;
+            if (writeText(m_fileName, SuiteWriter::format(m_suite, m_type), &error) == false) {
+                m_failures->add(error);
+            }
+        }
+
+    private:
+        const MotionSuite *m_suite;
+        QString m_fileName;
+        MotionSuite::OutputType m_type;
+        Failures *m_failures;
+    };
+
+    //! Format and write a scaled motion on a worker thread
+    class TimeSeriesJob : public QRunnable {
+    public:
+        TimeSeriesJob(const Motion *motion, double scalar, const QString &fileName,
+                      Failures *failures)
+                : m_motion(motion), m_scalar(scalar), m_fileName(fileName), m_failures(failures) {
+        }
+
+        void run() {
+            QString error;
+            if (writeText(m_fileName, SuiteWriter::formatAt2(m_motion, m_scalar), &error) == false) {
+                m_failures->add(error);
+            }
+        }
+
+    private:
+        const Motion *m_motion;
+        double m_scalar;
+        QString m_fileName;
+        Failures *m_failures;
+    };
+}
+
+QByteArray SuiteWriter::format(const MotionSuite *suite, MotionSuite::OutputType type) {
+    const int rowCount = suite->rowCount();
+    const QVector<double> &period = suite->period();
+
+    // The motions may be scaled for plotting, so the values are scaled
+    // relative to the scale that is applied
+    QVector<const Motion *> motions(rowCount);
+    QVector<double> factors(rowCount);
+    for (int i = 0; i < rowCount; ++i) {
+        motions[i] = suite->selectMotion(i);
+        factors[i] = suite->selectScalar(i) / motions.at(i)->scale();
+    }
+
+    QByteArray out;
+
+    if (type == MotionSuite::SummaryOutput || type == MotionSuite::CSVOutput) {
+        out.reserve(256 * rowCount
+                    + ((type == MotionSuite::CSVOutput) ? 16 * period.size() * (rowCount + 3) : 0));
+
+        // Print the error information
+        out += "Median RMSE,";
+        appendNumber(out, suite->medianError());
+        out += "\nMedian Max Error (%),";
+        appendNumber(out, suite->medianMaxError());
+        out += "\nStd RMSE,";
+        appendNumber(out, suite->stdevError());
+        out += "\nSigma Inf,";
+        appendNumber(out, suite->sigmaInf());
+        out += '\n';
+
+        // Print a table of the scaled motions
+        out += "Name,Scale,PGA (g),PGV (cm/s),PGD (cm),Dur. 5-75 (s),Dur. 5-95 (s),Details,\n";
+
+        for (int row = 0; row < rowCount; ++row) {
+            const Motion *motion = motions.at(row);
+            const double factor = factors.at(row);
+
+            out += motion->name().toUtf8();
+            out += ',';
+            appendFixed(out, suite->selectScalar(row), 4);
+            out += ',';
+            appendFixed(out, factor * motion->pga(), 4);
+            out += ',';
+            appendFixed(out, factor * motion->pgv(), 4);
+            out += ',';
+            appendFixed(out, factor * motion->pgd(), 4);
+            out += ',';
+            appendFixed(out, motion->dur5_75(), 4);
+            out += ',';
+            appendFixed(out, motion->dur5_95(), 4);
+            out += ",\"";
+            out += motion->details().toUtf8();
+            out += "\",\n";
+        }
+
+        if (type == MotionSuite::CSVOutput) {
+            // Print out the response spectra headers
+            out += "\n\nPeriod (s),Median Sa (g),Sigma_ln";
+            for (const Motion *motion : motions) {
+                out += ',';
+                out += motion->name().toUtf8();
+            }
+            out += '\n';
+
+            // Print the response spectra data
+            const QVector<double> &lnAvg = suite->lnAvg();
+            const QVector<double> &lnStd = suite->lnStd();
+            for (int i = 0; i < period.size(); ++i) {
+                // Print the period, median, and standard deviation
+                appendNumber(out, period.at(i));
+                out += ',';
+                appendNumber(out, exp(lnAvg.at(i)));
+                out += ',';
+                appendNumber(out, lnStd.at(i));
+                // Print out the individual motions
+                for (int j = 0; j < rowCount; ++j) {
+                    out += ',';
+                    appendNumber(out, factors.at(j) * motions.at(j)->sa().at(i));
+                }
+                out += '\n';
+            }
+        }
+    } else if (type == MotionSuite::StrataOutput) {
+        for (int i = 0; i < rowCount; ++i) {
+            out += motions.at(i)->fileName().toUtf8();
+            out += ',';
+            appendNumber(out, suite->selectScalar(i));
+            out += '\n';
+        }
+    } else if (type == MotionSuite::SHAKE2000Output) {
+        // Fixed width columns
+        QString text = QString("Median RMSE: %1 Max Error: %2% Std RMSE: %3 Sigma Inf: %4\n")
+                .arg(suite->medianError(), 6, 'f', 4)
+                .arg(suite->medianMaxError(), 6, 'f', 3)
+                .arg(suite->stdevError(), 6, 'f', 4)
+                .arg(suite->sigmaInf(), 4, 'f', 2);
+
+        text += QString("%1%2\n").arg("Motion", -80).arg("Scale", -6);
+
+        for (int i = 0; i < rowCount; ++i) {
+            text += QString("%1%2\n")
+                    .arg(motions.at(i)->name(), -80)
+                    .arg(suite->selectScalar(i), -6, 'f', 3);
+        }
+        out = text.toUtf8();
+    }
+
+    return out;
+}
+
+QByteArray SuiteWriter::formatAt2(const Motion *motion, double scalar) {
+    const TimeSeries &acc = motion->acc();
+    // The motion may be scaled for plotting
+    const double factor = scalar / motion->scale();
+
+    QByteArray out;
+    out.reserve(128 + motion->details().size() + 16 * acc.size());
+
+    // Header in the format of the PEER NGA database
+    out += "SigmaSpectra scaled record, scale factor ";
+    appendNumber(out, scalar);
+    out += '\n';
+    out += motion->details().toUtf8();
+    out += "\nACCELERATION TIME SERIES IN UNITS OF G\n";
+    out += "NPTS=" + QByteArray::number(acc.size()).rightJustified(8)
+           + ", DT=" + QByteArray::number(motion->dt(), 'f', 6).rightJustified(10) + " SEC\n";
+
+    // Five values per line
+    for (int i = 0; i < acc.size(); ++i) {
+        out += QByteArray::number(factor * acc.at(i), 'E', 7).rightJustified(15);
+        if (i % 5 == 4 || i == acc.size() - 1) {
+            out += '\n';
+        }
+    }
+
+    return out;
+}
+
+bool SuiteWriter::write(const QString &fileName, const QByteArray &data) {
+    QString error;
+
+    if (writeText(fileName, data, &error) == false) {
+        qCritical() << qPrintable(error);
+        return false;
+    }
+
+    return true;
+}
+
+bool SuiteWriter::write(const QList<MotionSuite *> &suites, const QStringList &fileNames,
+                        MotionSuite::OutputType type) {
+    Q_ASSERT(suites.size() == fileNames.size());
+
+    Failures failures;
+    QThreadPool pool;
+
+    for (int i = 0; i < suites.size(); ++i) {
+        pool.start(new WriteJob(suites.at(i), fileNames.at(i), type, &failures));
+    }
+    pool.waitForDone();
+
+    if (failures.isEmpty() == false) {
+        failures.report();
+        return false;
+    }
+
+    return true;
+}
+
+bool SuiteWriter::writeNumpy(const QString &fileName, const QList<MotionSuite *> &suites) {
+    if (suites.isEmpty()) {
+        qCritical("No suites to export.");
+        return false;
+    }
+
+    const QVector<double> &period = suites.first()->period();
+    const int suiteCount = suites.size();
+    const int periodCount = period.size();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    int motionCount = 0;
+    int nameLength = 1;
+    int fileNameLength = 1;
+    for (const MotionSuite *suite : suites) {
+        motionCount = qMax(motionCount, suite->rowCount());
+        for (int i = 0; i < suite->rowCount(); ++i) {
+            nameLength = qMax(nameLength, suite->selectMotion(i)->name().size());
+            fileNameLength = qMax(fileNameLength, suite->selectMotion(i)->fileName().size());
+        }
+    }
+
+    ZipArchive archive;
+
+    // Target spectrum
+    NpyArray periodArray("<f8", {periodCount}, 8);
+    NpyArray targetSa("<f8", {periodCount}, 8);
+    NpyArray targetLnStd("<f8", {periodCount}, 8);
+    for (int i = 0; i < periodCount; ++i) {
+        periodArray.append(period.at(i));
+        targetSa.append(exp(suites.first()->targetLnSa().at(i)));
+        targetLnStd.append(suites.first()->targetLnStd().at(i));
+    }
+    archive.add("period.npy", periodArray.data());
+    archive.add("target_sa.npy", targetSa.data());
+    archive.add("target_ln_std.npy", targetLnStd.data());
+
+    // Errors and statistics of the suites
+    NpyArray medianRmse("<f8", {suiteCount}, 8);
+    NpyArray medianMaxError("<f8", {suiteCount}, 8);
+    NpyArray stdRmse("<f8", {suiteCount}, 8);
+    NpyArray sigmaInf("<f8", {suiteCount}, 8);
+    NpyArray medianSa("<f8", {suiteCount, periodCount}, 8);
+    NpyArray lnStd("<f8", {suiteCount, periodCount}, 8);
+
+    for (const MotionSuite *suite : suites) {
+        medianRmse.append(suite->medianError());
+        medianMaxError.append(suite->medianMaxError());
+        stdRmse.append(suite->stdevError());
+        sigmaInf.append(suite->sigmaInf());
+        for (int i = 0; i < periodCount; ++i) {
+            medianSa.append(exp(suite->lnAvg().at(i)));
+            lnStd.append(suite->lnStd().at(i));
+        }
+    }
+    archive.add("median_rmse.npy", medianRmse.data());
+    archive.add("median_max_error.npy", medianMaxError.data());
+    archive.add("std_rmse.npy", stdRmse.data());
+    archive.add("sigma_inf.npy", sigmaInf.data());
+    archive.add("median_sa.npy", medianSa.data());
+    archive.add("ln_std.npy", lnStd.data());
+
+    // Scaled motions of the suites
+    const QByteArray nameDescr = "<U" + QByteArray::number(nameLength);
+    const QByteArray fileNameDescr = "<U" + QByteArray::number(fileNameLength);
+    NpyArray name(nameDescr, {suiteCount, motionCount}, 4 * nameLength);
+    NpyArray motionFileName(fileNameDescr, {suiteCount, motionCount}, 4 * fileNameLength);
+    NpyArray scalar("<f8", {suiteCount, motionCount}, 8);
+    NpyArray pga("<f8", {suiteCount, motionCount}, 8);
+    NpyArray pgv("<f8", {suiteCount, motionCount}, 8);
+    NpyArray pgd("<f8", {suiteCount, motionCount}, 8);
+    NpyArray dur5_75("<f8", {suiteCount, motionCount}, 8);
+    NpyArray dur5_95("<f8", {suiteCount, motionCount}, 8);
+    NpyArray sa("<f8", {suiteCount, motionCount, periodCount}, 8);
+
+    for (const MotionSuite *suite : suites) {
+        for (int row = 0; row < motionCount; ++row) {
+            if (row >= suite->rowCount()) {
+                name.append(QString(), nameLength);
+                motionFileName.append(QString(), fileNameLength);
+                for (NpyArray *array : {&scalar, &pga, &pgv, &pgd, &dur5_75, &dur5_95}) {
+                    array->append(nan);
+                }
+                for (int i = 0; i < periodCount; ++i) {
+                    sa.append(nan);
+                }
+                continue;
+            }
+
+            const Motion *motion = suite->selectMotion(row);
+            const double factor = suite->selectScalar(row) / motion->scale();
+
+            name.append(motion->name(), nameLength);
+            motionFileName.append(motion->fileName(), fileNameLength);
+            scalar.append(suite->selectScalar(row));
+            pga.append(factor * motion->pga());
+            pgv.append(factor * motion->pgv());
+            pgd.append(factor * motion->pgd());
+            dur5_75.append(motion->dur5_75());
+            dur5_95.append(motion->dur5_95());
+            for (int i = 0; i < periodCount; ++i) {
+                sa.append(factor * motion->sa().at(i));
+            }
+        }
+    }
+    archive.add("name.npy", name.data());
+    archive.add("file_name.npy", motionFileName.data());
+    archive.add("scalar.npy", scalar.data());
+    archive.add("pga.npy", pga.data());
+    archive.add("pgv.npy", pgv.data());
+    archive.add("pgd.npy", pgd.data());
+    archive.add("dur5_75.npy", dur5_75.data());
+    archive.add("dur5_95.npy", dur5_95.data());
+    archive.add("sa.npy", sa.data());
+
+    QFile file(fileName);
+    if (file.open(QIODevice::WriteOnly) == false) {
+        qCritical() << "Unable to open file:" << fileName;
+        return false;
+    }
+
+    const QByteArray data = archive.finish();
+    if (file.write(data) != data.size()) {
+        qCritical() << "Unable to write to file:" << fileName;
+        return false;
+    }
+
+    return true;
+}
+
+bool SuiteWriter::writeTimeSeries(const QList<MotionSuite *> &suites, const QStringList &suiteNames,
+                                  const QString &dirName, bool packed) {
+    Q_ASSERT(suites.size() == suiteNames.size());
+
+    QDir dir(dirName);
+    if (dir.exists() == false && dir.mkpath(".") == false) {
+        qCritical() << "Unable to create directory:" << dir.absolutePath();
+        return false;
+    }
+
+    // File of each unique scaled motion
+    QHash<QPair<const Motion *, double>, QString> files;
+    QList<QPair<const Motion *, double>> unique;
+    QHash<QString, int> usedNames;
+
+    QByteArray manifest = "Suite,Motion,Scale,Original,File\n";
+
+    for (int s = 0; s < suites.size(); ++s) {
+        const MotionSuite *suite = suites.at(s);
+
+        for (int row = 0; row < suite->rowCount(); ++row) {
+            const Motion *motion = suite->selectMotion(row);
+            const QPair<const Motion *, double> key(motion, suite->selectScalar(row));
+
+            if (files.contains(key) == false) {
+                // Motions with the same name are distinguished by a count
+                QString name = QString("%1-x%2")
+                        .arg(QFileInfo(motion->fileName()).completeBaseName())
+                        .arg(key.second, 0, 'f', 4);
+                const int n = usedNames.value(name, 0);
+                usedNames.insert(name, n + 1);
+                if (n > 0) {
+                    name += QString("-%1").arg(n + 1);
+                }
+
+                files.insert(key, packed ? name : name + ".AT2");
+                unique << key;
+            }
+
+            manifest += suiteNames.at(s).toUtf8() + ',' + motion->name().toUtf8() + ',';
+            appendNumber(manifest, key.second);
+            manifest += ",\"" + motion->fileName().toUtf8() + "\"," + files.value(key).toUtf8()
+                        + '\n';
+        }
+    }
+
+    if (packed) {
+        PackedLibrary library;
+        if (library.create(dir.absoluteFilePath("motions.sslib"), false) == false) {
+            return false;
+        }
+
+        for (const QPair<const Motion *, double> &key : unique) {
+            const Motion *motion = key.first;
+            const double factor = key.second / motion->scale();
+
+            QVector<double> acc = Motion::toDouble(motion->acc());
+            for (double &value : acc) {
+                value *= factor;
+            }
+
+            PackedLibrary::Record record;
+            record.fileName = files.value(key);
+            record.event = motion->event();
+            record.station = motion->station();
+            record.component = motion->component();
+            record.details = motion->details();
+            record.dt = motion->dt();
+
+            if (library.append(record, acc) == false) {
+                return false;
+            }
+        }
+
+        if (library.finish() == false) {
+            return false;
+        }
+    } else {
+        Failures failures;
+        QThreadPool pool;
+
+        for (const QPair<const Motion *, double> &key : unique) {
+            pool.start(new TimeSeriesJob(key.first, key.second,
+                                         dir.absoluteFilePath(files.value(key)), &failures));
+        }
+        pool.waitForDone();
+
+        if (failures.isEmpty() == false) {
+            failures.report();
+            return false;
+        }
+    }
+
+    return write(dir.absoluteFilePath("manifest.csv"), manifest);
+}
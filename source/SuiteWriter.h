@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SUITE_WRITER_H_
+#define SUITE_WRITER_H_
+
+#include "MotionSuite.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/*! SuiteWriter writes the selected suites to files.
+ *
+ * Each suite is formatted into a single buffer, with the numbers formatted
+ * directly instead of through the table model, and the buffer is written with
+ * one call. The scaled values are computed from the scalars of the suite, so
+ * the motions are not modified and suites can be formatted concurrently.
+ *
+ * All of the suites can also be written to a single NumPy archive (.npz),
+ * which is a zip file of uncompressed .npy arrays that is loaded with
+ * numpy.load(). The arrays are indexed by [suite, motion, period], where the
+ * motions are the components of the suite:
+ *  - period, target_sa, target_ln_std: the target spectrum
+ *  - median_rmse, median_max_error, std_rmse, sigma_inf: errors of each suite
+ *  - median_sa, ln_std: statistics of the scaled spectra of each suite
+ *  - name, file_name: the motions as unicode strings
+ *  - scalar, pga, pgv, pgd, dur5_75, dur5_95: the scaled motions
+ *  - sa: the scaled response spectra of the motions
+ * Suites with fewer motions are padded with NaN and empty strings.
+ *
+ * The scaled acceleration time series of the motions in the suites can be
+ * written as AT2 files or as a packed library. A motion that is used with the
+ * same scalar by several suites is only written once, and a manifest lists
+ * the file of each motion in each suite.
+ */
+class SuiteWriter {
+public:
+    /*! Format a suite.
+     * \param suite suite to format
+     * \param type output format
+     * \return UTF-8 encoded text
+     */
+    static QByteArray format(const MotionSuite *suite, MotionSuite::OutputType type);
+
+    /*! Format the scaled acceleration of a motion as an AT2 file.
+     * \param motion motion to format
+     * \param scalar scale factor relative to the unscaled motion
+     */
+    static QByteArray formatAt2(const Motion *motion, double scalar);
+
+    /*! Write a text buffer to a file. The line endings are converted to those
+     * of the platform, so binary data must not be written with this function.
+     * \param fileName name of the file
+     * \param data contents of the file
+     * \return true if the file was written
+     */
+    static bool write(const QString &fileName, const QByteArray &data);
+
+    /*! Write each of the suites to its own file in parallel.
+     * \param suites suites to write
+     * \param fileNames name of the file of each suite
+     * \param type output format
+     * \return true if all of the files were written
+     */
+    static bool write(const QList<MotionSuite *> &suites, const QStringList &fileNames,
+                      MotionSuite::OutputType type);
+
+    /*! Write all of the suites to a NumPy archive.
+     * \param fileName name of the file (*.npz)
+     * \param suites suites sharing the periods and target
+     * \return true if the file was written
+     */
+    static bool writeNumpy(const QString &fileName, const QList<MotionSuite *> &suites);
+
+    /*! Write the scaled acceleration time series of the motions in the suites.
+     * \param suites suites to write
+     * \param suiteNames name of each suite in the manifest
+     * \param dirName destination directory, created if needed
+     * \param packed if the motions are written to one packed library instead
+     * of AT2 files
+     * \return true if all of the files were written
+     */
+    static bool writeTimeSeries(const QList<MotionSuite *> &suites, const QStringList &suiteNames,
+                                const QString &dirName, bool packed = false);
+};
+
+#endif
@@ -0,0 +1,361 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#include "TargetSpectrum.h"
+
+#include <cmath>
+#include <limits>
+
+#include <gsl/gsl_interp.h>
+#include <gsl/gsl_spline.h>
+
+#include <QFile>
+#include <QObject>
+#include <QRegExp>
+#include <QStringList>
+#include <QTextStream>
+#include <QtDebug>
+
+/*! Interpolant holds the cubic splines of an input target.
+ *
+ * The spectral acceleration is interpolated as ln(Sa) versus ln(T). The
+ * standard deviation is already of the natural log, so it is interpolated
+ * versus ln(T) directly. A row at zero period (the PGA) is left out of the
+ * splines, and the values at the first positive period are used below it. A
+ * linear interpolation is used if there are too few points for a cubic
+ * spline.
+ */
+class TargetSpectrum::Interpolant {
+public:
+    Interpolant(const QVector<double> &period, const QVector<double> &sa,
+                const QVector<double> &lnStd);
+
+    ~Interpolant();
+
+    //! If the splines were built from the input
+    bool matches(const QVector<double> &period, const QVector<double> &sa,
+                 const QVector<double> &lnStd) const;
+
+    //! Interpolate the spectral acceleration and standard deviation
+    void eval(const QVector<double> &period, QVector<double> &sa, QVector<double> &lnStd) const;
+
+private:
+    Q_DISABLE_COPY(Interpolant)
+
+    //! Input the splines were built from -- copies are implicitly shared, so
+    //! the comparison is cheap while the input is unchanged
+    QVector<double> m_period;
+    QVector<double> m_sa;
+    QVector<double> m_lnStd;
+
+    //! Index of the first positive period
+    int m_first;
+
+    gsl_spline *m_saSpline;
+    gsl_spline *m_lnStdSpline;
+};
+
+TargetSpectrum::Interpolant::Interpolant(const QVector<double> &period,
+                                         const QVector<double> &sa,
+                                         const QVector<double> &lnStd)
+        : m_period(period), m_sa(sa), m_lnStd(lnStd), m_first(0),
+          m_saSpline(0), m_lnStdSpline(0) {
+    // The input is valid, so only the first period can be zero
+    while (m_first < period.size() && period.at(m_first) <= 0) {
+        ++m_first;
+    }
+
+    const int n = period.size() - m_first;
+    if (n < 2) {
+        // A single positive period is used at every period
+        return;
+    }
+
+    QVector<double> x(n);
+    QVector<double> ySa(n);
+    for (int i = 0; i < n; ++i) {
+        x[i] = log(period.at(m_first + i));
+        ySa[i] = log(sa.at(m_first + i));
+    }
+
+    const gsl_interp_type *type =
+        (n < int(gsl_interp_type_min_size(gsl_interp_cspline)))
+        ? gsl_interp_linear : gsl_interp_cspline;
+
+    m_saSpline = gsl_spline_alloc(type, n);
+    gsl_spline_init(m_saSpline, x.constData(), ySa.constData(), n);
+
+    m_lnStdSpline = gsl_spline_alloc(type, n);
+    gsl_spline_init(m_lnStdSpline, x.constData(), lnStd.constData() + m_first, n);
+}
+
+TargetSpectrum::Interpolant::~Interpolant() {
+    if (m_saSpline) {
+        gsl_spline_free(m_saSpline);
+        gsl_spline_free(m_lnStdSpline);
+    }
+}
+
+bool TargetSpectrum::Interpolant::matches(const QVector<double> &period,
+                                          const QVector<double> &sa,
+                                          const QVector<double> &lnStd) const {
+    return period == m_period && sa == m_sa && lnStd == m_lnStd;
+}
+
+void TargetSpectrum::Interpolant::eval(const QVector<double> &period, QVector<double> &sa,
+                                       QVector<double> &lnStd) const {
+    sa.resize(period.size());
+    lnStd.resize(period.size());
+
+    // The periods are increasing, so the accelerator follows them. Both
+    // splines share the abscissa, so one accelerator is used for both.
+    gsl_interp_accel *acc = gsl_interp_accel_alloc();
+
+    for (int i = 0; i < period.size(); ++i) {
+        if (m_saSpline == 0) {
+            sa[i] = m_sa.last();
+            lnStd[i] = m_lnStd.last();
+            continue;
+        }
+
+        // Periods within round off of the ends, and periods below the first
+        // positive period, are moved onto the range of the splines
+        const double p = qBound(m_period.at(m_first), period.at(i), m_period.last());
+        const double x = log(p);
+
+        sa[i] = exp(gsl_spline_eval(m_saSpline, x, acc));
+        lnStd[i] = gsl_spline_eval(m_lnStdSpline, x, acc);
+    }
+
+    gsl_interp_accel_free(acc);
+}
+
+TargetSpectrum::TargetSpectrum(const QString &name)
+        : m_name(name) {
+}
+
+const QString &TargetSpectrum::name() const {
+    return m_name;
+}
+
+void TargetSpectrum::setName(const QString &name) {
+    m_name = name;
+}
+
+QVector<double> &TargetSpectrum::inputPeriod() {
+    return m_inputPeriod;
+}
+
+QVector<double> &TargetSpectrum::inputSa() {
+    return m_inputSa;
+}
+
+QVector<double> &TargetSpectrum::inputLnStd() {
+    return m_inputLnStd;
+}
+
+const QVector<double> &TargetSpectrum::inputPeriod() const {
+    return m_inputPeriod;
+}
+
+const QVector<double> &TargetSpectrum::inputSa() const {
+    return m_inputSa;
+}
+
+const QVector<double> &TargetSpectrum::inputLnStd() const {
+    return m_inputLnStd;
+}
+
+bool TargetSpectrum::load(const QString &fileName) {
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text) == false) {
+        qCritical() << "Unable to open file:" << fileName;
+        return false;
+    }
+
+    m_inputPeriod.clear();
+    m_inputSa.clear();
+    m_inputLnStd.clear();
+
+    QTextStream fin(&file);
+    const QRegExp separator("[,;\\s]+");
+
+    while (fin.atEnd() == false) {
+        const QStringList cells = fin.readLine().trimmed().split(separator, QString::SkipEmptyParts);
+
+        if (cells.size() < 3) {
+            continue;
+        }
+
+        bool ok;
+        QVector<double> values(3);
+        for (int i = 0; i < values.size(); ++i) {
+            values[i] = cells.at(i).toDouble(&ok);
+            if (ok == false) {
+                break;
+            }
+        }
+        // Skip header and comment lines
+        if (ok == false) {
+            continue;
+        }
+
+        m_inputPeriod << values.at(0);
+        m_inputSa << values.at(1);
+        m_inputLnStd << values.at(2);
+    }
+
+    if (m_inputPeriod.isEmpty()) {
+        qCritical() << "No target found in file:" << fileName;
+        return false;
+    }
+
+    return true;
+}
+
+bool TargetSpectrum::save(const QString &fileName) const {
+    QFile file(fileName);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Text) == false) {
+        qCritical() << "Unable to open file:" << fileName;
+        return false;
+    }
+
+    QTextStream fout(&file);
+    fout << "Period (s),Spec. Accel. (g),Ln Stdev.\n";
+    for (int i = 0; i < m_inputPeriod.size(); ++i) {
+        fout << m_inputPeriod.at(i) << ","
+             << m_inputSa.at(i) << ","
+             << m_inputLnStd.at(i) << "\n";
+    }
+
+    return true;
+}
+
+bool TargetSpectrum::isValid() const {
+    if (m_inputPeriod.size() == 0) {
+        qCritical("No target specified");
+        return false;
+    }
+
+    // Period of the target spectrum must not be negative, and be strictly
+    // increasing for the interpolation. Only the first period can be zero.
+    if (m_inputPeriod.first() < 0) {
+        qCritical("The period of the input target spectrum must not be negative.");
+        return false;
+    }
+    for (int i = 0; i < m_inputPeriod.size() - 1; ++i) {
+        if (m_inputPeriod.at(i) >= m_inputPeriod.at(i + 1)) {
+            qCritical("The period of the input target spectrum must be "
+                      "strictly increasing. (T_1 < T_2)");
+            return false;
+        }
+    }
+
+    // Spectral acceleration must be greater than zero for the logarithm
+    for (int i = 0; i < m_inputSa.size(); ++i) {
+        if (m_inputSa.at(i) <= 0) {
+            qCritical("The spectral acceleration of the input target spectrum must be "
+                      "greater than zero.");
+            return false;
+        }
+    }
+
+    // Standard deviation must be greater than zero
+    for (int i = 0; i < m_inputLnStd.size(); ++i) {
+        if (m_inputLnStd.at(i) < 0) {
+            qCritical("The standard deviation of the input target spectrum must be "
+                      "greater than zero.");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool TargetSpectrum::prepare(const QVector<double> &period) {
+    if (period == m_inputPeriod) {
+        m_sa = m_inputSa;
+        m_lnStd = m_inputLnStd;
+    } else {
+        if (isBounded(m_inputPeriod, period) == false) {
+            return false;
+        }
+
+        if (m_interpolant.isNull()
+            || m_interpolant->matches(m_inputPeriod, m_inputSa, m_inputLnStd) == false) {
+            m_interpolant = QSharedPointer<const Interpolant>(
+                    new Interpolant(m_inputPeriod, m_inputSa, m_inputLnStd));
+        }
+
+        m_interpolant->eval(period, m_sa, m_lnStd);
+    }
+
+    // Compute the target in log space
+    m_lnSa.resize(m_sa.size());
+    for (int i = 0; i < m_sa.size(); ++i) {
+        m_lnSa[i] = log(m_sa.at(i));
+    }
+
+    return true;
+}
+
+const QVector<double> &TargetSpectrum::sa() const {
+    return m_sa;
+}
+
+const QVector<double> &TargetSpectrum::lnSa() const {
+    return m_lnSa;
+}
+
+const QVector<double> &TargetSpectrum::lnStd() const {
+    return m_lnStd;
+}
+
+QVector<double> TargetSpectrum::fractile(double eps) const {
+    QVector<double> values(m_lnSa.size());
+    for (int i = 0; i < m_lnSa.size(); ++i) {
+        values[i] = exp(eps * m_lnStd.at(i) + m_lnSa.at(i));
+    }
+    return values;
+}
+
+bool TargetSpectrum::isBounded(const QVector<double> &x, const QVector<double> &xi) {
+    // Period (x) has already been checked to ensure that it is increasing
+    // Check if all of the data is bounded
+    if (std::fabs(xi.first() - x.first()) >
+            std::numeric_limits<double>::epsilon() &&
+            xi.first() < x.first()) {
+        qCritical() << QString(
+                QObject::tr("Minimum interpolated value (%1) is less than specified value (%2)")
+                .arg(xi.first())
+                .arg(x.first()));
+        return false;
+    }
+
+    if (std::fabs(xi.last() - x.last()) >
+            std::numeric_limits<double>::epsilon() &&
+            xi.last() > x.last()) {
+        qCritical() << QString(QObject::tr("Maximum interpolated value (%1) is greater than "
+                    "specificed value (%2)"))
+            .arg(xi.last())
+            .arg(x.last());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TARGET_SPECTRUM_H_
+#define TARGET_SPECTRUM_H_
+
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+/*! TargetSpectrum is the response spectrum the suites are fit to.
+ *
+ * The input target is specified by the user at arbitrary periods, and is then
+ * prepared at the periods of the motion library before selection.
+ */
+class TargetSpectrum {
+public:
+    TargetSpectrum(const QString &name = QString());
+
+    //! Name used to identify the target in the output
+    const QString &name() const;
+
+    void setName(const QString &name);
+
+    //! Input target specified by the user
+    //@{
+    QVector<double> &inputPeriod();
+
+    QVector<double> &inputSa();
+
+    QVector<double> &inputLnStd();
+
+    const QVector<double> &inputPeriod() const;
+
+    const QVector<double> &inputSa() const;
+
+    const QVector<double> &inputLnStd() const;
+    //@}
+
+    /*! Load the input target from a file.
+     * Each line of the file provides the period (s), spectral acceleration
+     * (g), and the logarithmic standard deviation separated by commas or white
+     * space. Lines that do not start with a number are ignored.
+     * \param fileName name of the file
+     * \return true if the target was successfully loaded
+     */
+    bool load(const QString &fileName);
+
+    /*! Save the input target to a file in the format read by load().
+     * \param fileName name of the file
+     * \return true if the target was successfully saved
+     */
+    bool save(const QString &fileName) const;
+
+    /*! Check that the input target is valid. The periods must be strictly
+     * increasing and only the first can be zero. The spectral acceleration
+     * must be positive and the standard deviation must not be negative.
+     */
+    bool isValid() const;
+
+    /*! Compute the target at the periods of the motion library.
+     * The input target is interpolated with cubic splines in log-log space.
+     * Below the first positive period the values at that period are used,
+     * so a row at zero period does not take part in the interpolation.
+     * The splines are built once and reused until the input target changes.
+     * \param period periods of the motion library
+     * \return true if the operation was successful
+     */
+    bool prepare(const QVector<double> &period);
+
+    //! Target at the periods of the motion library
+    //@{
+    const QVector<double> &sa() const;
+
+    const QVector<double> &lnSa() const;
+
+    const QVector<double> &lnStd() const;
+
+    QVector<double> fractile(double eps) const;
+    //@}
+
+private:
+    class Interpolant;
+
+    /*! Check that the values are within the range of the input period.
+     * \param x input period
+     * \param xi periods to interpolate at
+     */
+    static bool isBounded(const QVector<double> &x, const QVector<double> &xi);
+
+    QString m_name;
+
+    QVector<double> m_inputPeriod;
+    QVector<double> m_inputSa;
+    QVector<double> m_inputLnStd;
+
+    QVector<double> m_sa;
+    QVector<double> m_lnSa;
+    QVector<double> m_lnStd;
+
+    //! Splines of the input target, shared by copies of the target
+    QSharedPointer<const Interpolant> m_interpolant;
+};
+
+#endif
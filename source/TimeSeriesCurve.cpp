@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "TimeSeriesCurve.h"
+
+#include <qwt_scale_map.h>
+
+#include <cmath>
+
+TimeSeriesData::TimeSeriesData(const TimeSeries &time, const TimeSeries &values)
+        : m_time(time), m_values(values), m_level(0) {
+    const int n = count();
+    if (n > 0) {
+        double minValue = m_values.first();
+        double maxValue = m_values.first();
+        for (int i = 1; i < n; ++i) {
+            minValue = qMin<double>(minValue, m_values.at(i));
+            maxValue = qMax<double>(maxValue, m_values.at(i));
+        }
+        m_boundingRect = QRectF(m_time.first(), minValue, m_time.at(n - 1) - m_time.first(),
+                                maxValue - minValue);
+    }
+}
+
+size_t TimeSeriesData::size() const {
+    return m_level ? points(m_level).size() : count();
+}
+
+QPointF TimeSeriesData::sample(size_t i) const {
+    if (m_level) {
+        return points(m_level).at(int(i));
+    }
+    return QPointF(m_time.at(int(i)), m_values.at(int(i)));
+}
+
+QRectF TimeSeriesData::boundingRect() const {
+    return m_boundingRect;
+}
+
+int TimeSeriesData::count() const {
+    return qMin(m_time.size(), m_values.size());
+}
+
+int TimeSeriesData::indexAt(double time) const {
+    const int n = count();
+    if (n < 2) {
+        return 0;
+    }
+
+    // The time step is constant
+    const double dt = (m_time.at(n - 1) - m_time.first()) / (n - 1);
+    const double i = dt > 0 ? floor((time - m_time.first()) / dt) : 0;
+    return int(qBound(0., i, double(n - 1)));
+}
+
+int TimeSeriesData::level() const {
+    return m_level;
+}
+
+void TimeSeriesData::setLevel(int level) const {
+    m_level = level;
+}
+
+const QVector<QPointF> &TimeSeriesData::points(int level) const {
+    if (m_levels.size() <= level) {
+        m_levels.resize(level + 1);
+    }
+
+    QVector<QPointF> &points = m_levels[level];
+    if (points.isEmpty()) {
+        const int n = count();
+        const int bucket = 1 << level;
+        points.reserve(2 * ((n + bucket - 1) / bucket));
+
+        for (int begin = 0; begin < n; begin += bucket) {
+            const int end = qMin(begin + bucket, n);
+            int minIdx = begin;
+            int maxIdx = begin;
+            for (int i = begin + 1; i < end; ++i) {
+                if (m_values.at(i) < m_values.at(minIdx)) {
+                    minIdx = i;
+                } else if (m_values.at(i) > m_values.at(maxIdx)) {
+                    maxIdx = i;
+                }
+            }
+
+            // Two points for every bucket in the order of the samples
+            const int first = qMin(minIdx, maxIdx);
+            const int second = qMax(minIdx, maxIdx);
+            points << QPointF(m_time.at(first), m_values.at(first))
+                   << QPointF(m_time.at(second), m_values.at(second));
+        }
+    }
+
+    return points;
+}
+
+TimeSeriesCurve::TimeSeriesCurve() {
+    setRenderHint(QwtPlotItem::RenderAntialiased);
+}
+
+void TimeSeriesCurve::setSeries(const TimeSeries &time, const TimeSeries &values) {
+    setData(new TimeSeriesData(time, values));
+}
+
+void TimeSeriesCurve::drawSeries(QPainter *painter, const QwtScaleMap &xMap,
+                                 const QwtScaleMap &yMap, const QRectF &canvasRect,
+                                 int from, int to) const {
+    const TimeSeriesData *series = dynamic_cast<const TimeSeriesData *>(data());
+    if (series == 0 || series->count() < 2) {
+        QwtPlotCurve::drawSeries(painter, xMap, yMap, canvasRect, from, to);
+        return;
+    }
+
+    // Visible samples, with one extra on each side so that the line reaches
+    // the edges of the canvas
+    const int first = qMax(0, series->indexAt(qMin(xMap.s1(), xMap.s2())) - 1);
+    const int last = qMin(series->count() - 1,
+                          series->indexAt(qMax(xMap.s1(), xMap.s2())) + 1);
+
+    // Each bucket adds two points, so a bucket of the samples per pixel
+    // results in about two points per pixel
+    const double pixels = qMax(1., fabs(xMap.p2() - xMap.p1()));
+    const double perPixel = (last - first + 1) / pixels;
+    int level = 0;
+    while (level < 30 && (2 << level) <= perPixel) {
+        ++level;
+    }
+
+    series->setLevel(level);
+    if (level) {
+        QwtPlotCurve::drawSeries(painter, xMap, yMap, canvasRect, 2 * (first >> level),
+                                 2 * (last >> level) + 1);
+    } else {
+        QwtPlotCurve::drawSeries(painter, xMap, yMap, canvasRect, first, last);
+    }
+    series->setLevel(0);
+}
@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TIME_SERIES_CURVE_H_
+#define TIME_SERIES_CURVE_H_
+
+#include "Motion.h"
+
+#include <QPointF>
+#include <QRectF>
+#include <QVector>
+
+#include <qwt_plot_curve.h>
+#include <qwt_series_data.h>
+
+/*! TimeSeriesData provides a time series of a motion to a curve.
+ *
+ * The time and values are implicitly shared with the motion, so the samples
+ * are not copied. For drawing, the series can be decimated to a level where
+ * each bucket of 2^level samples is represented by its minimum and maximum.
+ * The levels are built when first drawn, and the extremes of every bucket are
+ * kept, so the peaks of the record are always shown.
+ */
+class TimeSeriesData : public QwtSeriesData<QPointF> {
+public:
+    TimeSeriesData(const TimeSeries &time, const TimeSeries &values);
+
+    size_t size() const;
+
+    QPointF sample(size_t i) const;
+
+    QRectF boundingRect() const;
+
+    //! Number of samples of the full series
+    int count() const;
+
+    //! Index of the sample at or before the time
+    int indexAt(double time) const;
+
+    //! Level used by size() and sample(), 0 is the full series
+    int level() const;
+
+    void setLevel(int level) const;
+
+private:
+    //! Build the minimum and maximum of each bucket of the level
+    const QVector<QPointF> &points(int level) const;
+
+    TimeSeries m_time;
+    TimeSeries m_values;
+
+    QRectF m_boundingRect;
+
+    mutable int m_level;
+
+    //! Decimated points of each level, index 0 is unused
+    mutable QVector<QVector<QPointF>> m_levels;
+};
+
+/*! TimeSeriesCurve draws a TimeSeriesData decimated to the width of the
+ * canvas, with about two points for each pixel of the visible time range.
+ */
+class TimeSeriesCurve : public QwtPlotCurve {
+public:
+    TimeSeriesCurve();
+
+    //! Share the time series of a motion, replacing the previous data
+    void setSeries(const TimeSeries &time, const TimeSeries &values);
+
+protected:
+    void drawSeries(QPainter *painter, const QwtScaleMap &xMap, const QwtScaleMap &yMap,
+                    const QRectF &canvasRect, int from, int to) const;
+};
+
+#endif
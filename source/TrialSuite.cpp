@@ -0,0 +1,194 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "TrialSuite.h"
+
+#include <cmath>
+
+TrialSuite::TrialSuite()
+        : m_size(0), m_targetLnSa(0) {
+}
+
+void TrialSuite::reset(int capacity, const QVector<double> &targetLnSa) {
+    m_size = 0;
+    m_indices.fill(-1, capacity);
+    m_lnAvg.fill(0, targetLnSa.size());
+    m_targetLnSa = targetLnSa.constData();
+}
+
+void TrialSuite::clear() {
+    m_size = 0;
+}
+
+int TrialSuite::size() const {
+    return m_size;
+}
+
+const int *TrialSuite::indices() const {
+    return m_indices.constData();
+}
+
+bool TrialSuite::isMotionValid(int index, const QVector<int> &groups) const {
+    // The groups are unique to each motion if more than one motion per station
+    // is permitted, so this also checks for a repeated motion
+    const int group = groups.at(index);
+    for (int i = 0; i < m_size; ++i) {
+        if (groups.at(m_indices.at(i)) == group) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double TrialSuite::checkMotion(const double *lnSa) const {
+    return computeError(lnSa, m_size + 1);
+}
+
+void TrialSuite::addMotion(int index, const double *lnSa) {
+    Q_ASSERT(m_size < m_indices.size());
+
+    m_indices[m_size] = index;
+    ++m_size;
+
+    double *lnAvg = m_lnAvg.data();
+    const int n = m_size;
+    if (n > 1) {
+        // Combine the previous average with the new value
+        for (int i = 0; i < m_lnAvg.size(); ++i) {
+            lnAvg[i] = lnAvg[i] * (n - 1) / n + lnSa[i] / n;
+        }
+    } else {
+        for (int i = 0; i < m_lnAvg.size(); ++i) {
+            lnAvg[i] = lnSa[i];
+        }
+    }
+}
+
+double TrialSuite::medianError() const {
+    return computeError(0, m_size);
+}
+
+double TrialSuite::computeError(const double *lnSa, int n) const {
+    const double *lnAvg = m_lnAvg.constData();
+    const int count = m_lnAvg.size();
+
+    // The average with the new motion is computed in both passes instead of
+    // being stored
+    const auto value = [=](int i) {
+        return lnSa ? lnAvg[i] * (n - 1) / n + lnSa[i] / n : lnAvg[i];
+    };
+
+    // Optimal scale factor
+    double sum = 0;
+    for (int i = 0; i < count; ++i) {
+        sum += m_targetLnSa[i] - value(i);
+    }
+    const double scalar = sum / count;
+
+    double sse = 0;
+    for (int i = 0; i < count; ++i) {
+        sse += pow(scalar + value(i) - m_targetLnSa[i], 2);
+    }
+
+    return sqrt(sse / count);
+}
+
+TrialPool::TrialPool()
+        : m_capacity(0), m_suiteSize(0), m_size(0), m_worstLoc(-1), m_worstError(0) {
+}
+
+void TrialPool::reset(int capacity, int suiteSize) {
+    m_capacity = capacity;
+    m_suiteSize = suiteSize;
+    m_size = 0;
+    m_worstLoc = -1;
+    m_worstError = 0;
+    m_indices.fill(-1, capacity * suiteSize);
+    m_errors.fill(0, capacity);
+}
+
+int TrialPool::size() const {
+    return m_size;
+}
+
+QVector<int> TrialPool::indices(int i) const {
+    return m_indices.mid(i * m_suiteSize, m_suiteSize);
+}
+
+double TrialPool::error(int i) const {
+    return m_errors.at(i);
+}
+
+bool TrialPool::add(const TrialSuite &suite) {
+    if (suite.size() != m_suiteSize || m_capacity < 1 || isRepeated(suite)) {
+        return false;
+    }
+
+    const double error = suite.medianError();
+
+    int loc;
+    if (m_size < m_capacity) {
+        loc = m_size++;
+    } else if (error < m_worstError) {
+        // Replace the suite with the worst error
+        loc = m_worstLoc;
+    } else {
+        return false;
+    }
+
+    int *indices = m_indices.data() + loc * m_suiteSize;
+    for (int j = 0; j < m_suiteSize; ++j) {
+        indices[j] = suite.indices()[j];
+    }
+    m_errors[loc] = error;
+
+    // Update the location of the worst error
+    m_worstLoc = 0;
+    m_worstError = m_errors.at(0);
+    for (int i = 1; i < m_size; ++i) {
+        if (m_errors.at(i) > m_worstError) {
+            m_worstError = m_errors.at(i);
+            m_worstLoc = i;
+        }
+    }
+
+    return true;
+}
+
+bool TrialPool::isRepeated(const TrialSuite &suite) const {
+    // The motions of a suite are unique, so the suites are the same if all of
+    // the motions are found
+    for (int i = 0; i < m_size; ++i) {
+        const int *saved = m_indices.constData() + i * m_suiteSize;
+        int repeats = 0;
+        for (int j = 0; j < m_suiteSize; ++j) {
+            for (int k = 0; k < m_suiteSize; ++k) {
+                if (saved[j] == suite.indices()[k]) {
+                    ++repeats;
+                    break;
+                }
+            }
+        }
+
+        if (repeats == m_suiteSize) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TRIAL_SUITE_H_
+#define TRIAL_SUITE_H_
+
+#include <QVector>
+
+/*! TrialSuite is the plain-data suite grown from a seed during the selection.
+ *
+ * The motions are referenced by their index in the candidates and the buffers
+ * are allocated once with reset(), so that the suite can be cleared and grown
+ * again for every seed without allocating. A MotionSuite is only created for
+ * the suites that are kept.
+ */
+class TrialSuite {
+public:
+    TrialSuite();
+
+    /*! Allocate the buffers and clear the suite.
+     * \param capacity maximum number of motions
+     * \param targetLnSa natural log of the target, which needs to outlive the suite
+     */
+    void reset(int capacity, const QVector<double> &targetLnSa);
+
+    //! Remove the motions while keeping the buffers
+    void clear();
+
+    int size() const;
+
+    //! Candidate indices of the motions
+    const int *indices() const;
+
+    /*! Test if the motion could be added to the suite.
+     * \param index candidate index of the motion
+     * \param groups group of each candidate, a suite has one motion per group
+     */
+    bool isMotionValid(int index, const QVector<int> &groups) const;
+
+    /*! Check the fit of the median response spectrum with a new motion
+     * \param lnSa natural log of the spectral acceleration of the motion
+     * \return root mean square error of the median
+     */
+    double checkMotion(const double *lnSa) const;
+
+    //! Add a motion, the suite must not be full
+    void addMotion(int index, const double *lnSa);
+
+    //! Root mean square error of the median
+    double medianError() const;
+
+private:
+    //! Root mean square error of the average with the motion added -- the
+    //! same arithmetic as MotionSuite
+    double computeError(const double *lnSa, int n) const;
+
+    int m_size;
+
+    QVector<int> m_indices;
+
+    //! Natural log of the average spectral acceleration
+    QVector<double> m_lnAvg;
+
+    const double *m_targetLnSa;
+};
+
+/*! TrialPool keeps the best suites of a target in fixed storage.
+ *
+ * The suites are stored as candidate indices. A suite replaces the one with
+ * the largest error once the pool is full, and repeated suites are ignored.
+ */
+class TrialPool {
+public:
+    TrialPool();
+
+    /*! Allocate the storage and remove the suites.
+     * \param capacity number of suites kept
+     * \param suiteSize number of motions in a suite
+     */
+    void reset(int capacity, int suiteSize);
+
+    int size() const;
+
+    //! Candidate indices of the motions of a suite
+    QVector<int> indices(int i) const;
+
+    //! Root mean square error of the median of a suite
+    double error(int i) const;
+
+    /*! Add the suite if it is better than the worst.
+     * \return false if the suite was not saved
+     */
+    bool add(const TrialSuite &suite);
+
+private:
+    //! If the suite contains the same motions as a saved suite
+    bool isRepeated(const TrialSuite &suite) const;
+
+    int m_capacity;
+    int m_suiteSize;
+    int m_size;
+
+    //! Location and error of the saved suite with the largest error
+    int m_worstLoc;
+    double m_worstError;
+
+    //! Indices of the suites stored as capacity x suite size
+    QVector<int> m_indices;
+
+    QVector<double> m_errors;
+};
+
+#endif
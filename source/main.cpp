@@ -19,11 +19,14 @@
 // Copyright 2008-2017 Albert Kottke
 ////////////////////////////////////////////////////////////////////////////////////
 
+#include "BatchRunner.h"
 #include "MainWindow.h"
+#include "RecordReader.h"
 #include "defines.h"
 
 #include <QApplication>
 #include <QMessageBox>
+#include <QSettings>
 
 void debugHandler(QtMsgType type, const QMessageLogContext &context,
         const QString &msg) {
@@ -92,16 +95,32 @@ void releaseHandler(QtMsgType type, const QMessageLogContext &context,
 }
 
 int main(int argc, char *argv[]) {
+    QCoreApplication::setOrganizationName("ARKottke");
+    QCoreApplication::setApplicationName(PROJECT_LONGNAME);
+    QCoreApplication::setApplicationVersion(PROJECT_VERSION);
+
+    // The extensions of two column files are generic, so the reader is only
+    // registered on request and before any directory is scanned
+    if (QSettings().value("library/twoColumnRecords", false).toBool()
+        || BatchRunner::isTwoColumnRequested(argc, argv)) {
+        RecordReader::add(RecordReader::createTwoColumnReader());
+    }
+
+    if (BatchRunner::isRequested(argc, argv)) {
+        // Messages are written to the console without the graphical interface
+        qInstallMessageHandler(debugHandler);
+
+        QCoreApplication app(argc, argv);
+        BatchRunner runner;
+        return runner.exec(app.arguments());
+    }
+
 #ifdef Debug
     qInstallMessageHandler(debugHandler);
 #else
     qInstallMessageHandler(releaseHandler);
 #endif
 
-    QCoreApplication::setOrganizationName("ARKottke");
-    QCoreApplication::setApplicationName(PROJECT_LONGNAME);
-    QCoreApplication::setApplicationVersion(PROJECT_VERSION);
-
     QApplication app(argc, argv);
     app.setWindowIcon(QIcon(":/images/application-icon.svg"));
 
@@ -0,0 +1,339 @@
+////////////////////////////////////////////////////////////////////////////////////
+// This file is part of SigmaSpectra.
+//
+// SigmaSpectra is free software: you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation, either version 3 of the License, or (at your option) any later
+// version.
+//
+// SigmaSpectra is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// SigmaSpectra.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Copyright 2008-2017 Albert Kottke
+////////////////////////////////////////////////////////////////////////////////////
+
+#include "SeedSpace.h"
+
+#include <QtTest/QtTest>
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    //! Candidate motion of the selection
+    struct Candidate {
+        QString station;
+        bool disabled;
+        bool required;
+    };
+
+    /*! Groups of the candidates as defined by MotionLibrary: disabled motions
+     * are not candidates and required motions are ordinary candidates.
+     */
+    QVector<int> groupsOf(const QList<Candidate> &motions, bool oneMotionPerStation) {
+        QVector<int> groups;
+        QHash<QString, int> stations;
+        for (const Candidate &motion : motions) {
+            if (motion.disabled) {
+                continue;
+            }
+
+            if (oneMotionPerStation) {
+                const int g = stations.value(motion.station, stations.size());
+                stations.insert(motion.station, g);
+                groups << g;
+            } else {
+                groups << groups.size();
+            }
+        }
+        return groups;
+    }
+
+    //! Key of a seed independent of the order of the motions
+    QString keyOf(QVector<int> seed) {
+        std::sort(seed.begin(), seed.end());
+        QStringList parts;
+        for (int i : seed) {
+            parts << QString::number(i);
+        }
+        return parts.join(",");
+    }
+
+    //! Seeds found by checking every subset of the candidates
+    QSet<QString> bruteForce(const QVector<int> &groups, int seedSize) {
+        QSet<QString> seeds;
+        const int n = groups.size();
+        for (quint32 mask = 0; mask < (1u << n); ++mask) {
+            QVector<int> seed;
+            QSet<int> used;
+            bool valid = true;
+            for (int i = 0; i < n; ++i) {
+                if (mask & (1u << i)) {
+                    valid = valid && !used.contains(groups.at(i));
+                    used.insert(groups.at(i));
+                    seed << i;
+                }
+            }
+
+            if (valid && seed.size() == seedSize) {
+                seeds.insert(keyOf(seed));
+            }
+        }
+        return seeds;
+    }
+
+    //! Compare the space with brute force and check the ranking of each seed
+    void checkSpace(const QVector<int> &groups, int seedSize) {
+        SeedSpace space;
+        space.reset(groups, seedSize);
+
+        const QSet<QString> expected = bruteForce(groups, seedSize);
+        QVERIFY(!space.isOverflow());
+        QCOMPARE(space.count(), quint64(expected.size()));
+        QCOMPARE(space.approxCount(), double(expected.size()));
+        QCOMPARE(space.isValid(), !expected.isEmpty());
+
+        if (expected.isEmpty()) {
+            return;
+        }
+
+        QSet<QString> found;
+        QVector<int> seed;
+        QVector<int> unranked;
+        quint64 rank = 0;
+        space.first(seed);
+        do {
+            QVERIFY(space.contains(seed));
+            QCOMPARE(space.rank(seed), rank);
+            space.unrank(rank, unranked);
+            QCOMPARE(unranked, seed);
+
+            found.insert(keyOf(seed));
+            ++rank;
+        } while (space.next(seed));
+
+        QCOMPARE(rank, space.count());
+        QCOMPARE(found, expected);
+    }
+}
+
+class SeedSpaceTests : public QObject {
+Q_OBJECT
+
+private slots:
+
+    void binomial();
+
+    void combinations();
+
+    void oneMotionPerStation();
+
+    void disabledAndRequired();
+
+    void contains();
+
+    void chunks();
+
+    void largeCount();
+
+    void overflow();
+};
+
+void SeedSpaceTests::binomial() {
+    // Pascal's triangle
+    QVector<quint64> row(1, 1);
+    for (int n = 1; n <= 60; ++n) {
+        QVector<quint64> next(n + 1, 1);
+        for (int k = 1; k < n; ++k) {
+            next[k] = row.at(k - 1) + row.at(k);
+        }
+        row = next;
+
+        for (int k = 0; k <= n; ++k) {
+            bool overflow;
+            QCOMPARE(SeedSpace::binomial(n, k, &overflow), row.at(k));
+            QVERIFY(!overflow);
+        }
+    }
+
+    bool overflow;
+    QCOMPARE(SeedSpace::binomial(5, 6, &overflow), quint64(0));
+    QCOMPARE(SeedSpace::binomial(67, 33, &overflow), Q_UINT64_C(14226520737620288370));
+    QVERIFY(!overflow);
+    SeedSpace::binomial(68, 34, &overflow);
+    QVERIFY(overflow);
+}
+
+void SeedSpaceTests::combinations() {
+    QList<Candidate> motions;
+    for (int i = 0; i < 8; ++i) {
+        motions << Candidate{QString("S%1").arg(i), false, false};
+    }
+
+    const QVector<int> groups = groupsOf(motions, false);
+    for (int seedSize = 1; seedSize <= groups.size() + 1; ++seedSize) {
+        checkSpace(groups, seedSize);
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+    }
+}
+
+void SeedSpaceTests::oneMotionPerStation() {
+    QList<Candidate> motions;
+    for (const char *station : {"A", "B", "A", "C", "B", "D", "A", "E", "C"}) {
+        motions << Candidate{station, false, false};
+    }
+
+    for (bool perStation : {false, true}) {
+        const QVector<int> groups = groupsOf(motions, perStation);
+        for (int seedSize = 1; seedSize <= 6; ++seedSize) {
+            checkSpace(groups, seedSize);
+            if (QTest::currentTestFailed()) {
+                return;
+            }
+        }
+    }
+}
+
+void SeedSpaceTests::disabledAndRequired() {
+    const QList<Candidate> motions = {
+            {"A", false, true},
+            {"B", true, false},
+            {"A", false, false},
+            {"C", false, false},
+            {"B", false, true},
+            {"D", true, false},
+            {"C", false, false},
+            {"E", false, false},
+            {"A", true, true},
+            {"F", false, false},
+    };
+
+    for (bool perStation : {false, true}) {
+        const QVector<int> groups = groupsOf(motions, perStation);
+        // Disabled motions are not candidates
+        QCOMPARE(groups.size(), 7);
+
+        for (int seedSize = 1; seedSize <= 5; ++seedSize) {
+            checkSpace(groups, seedSize);
+            if (QTest::currentTestFailed()) {
+                return;
+            }
+        }
+    }
+}
+
+void SeedSpaceTests::contains() {
+    // Groups: {0, 2}, {1}, {3}
+    SeedSpace space;
+    space.reset(QVector<int>{0, 1, 0, 2}, 2);
+
+    QVERIFY(space.contains(QVector<int>{0, 1}));
+    QVERIFY(space.contains(QVector<int>{2, 3}));
+    // Wrong size
+    QVERIFY(!space.contains(QVector<int>{0}));
+    QVERIFY(!space.contains(QVector<int>{0, 1, 3}));
+    // Same group
+    QVERIFY(!space.contains(QVector<int>{0, 2}));
+    // Not in the order of the groups
+    QVERIFY(!space.contains(QVector<int>{1, 0}));
+    // Not a candidate
+    QVERIFY(!space.contains(QVector<int>{0, 4}));
+    QVERIFY(!space.contains(QVector<int>{-1, 1}));
+}
+
+void SeedSpaceTests::chunks() {
+    QList<Candidate> motions;
+    for (const char *station : {"A", "B", "A", "C", "B", "D", "A", "E", "C", "F"}) {
+        motions << Candidate{station, false, false};
+    }
+
+    SeedSpace space;
+    space.reset(groupsOf(motions, true), 3);
+    const quint64 total = space.count();
+    QVERIFY(total > 0);
+
+    for (int chunkCount = 1; chunkCount <= int(total) + 2; ++chunkCount) {
+        quint64 previousEnd = 0;
+        for (int index = 0; index < chunkCount; ++index) {
+            quint64 begin;
+            quint64 end;
+            space.chunk(index, chunkCount, &begin, &end);
+
+            // The chunks are contiguous and differ in size by at most one
+            QCOMPARE(begin, previousEnd);
+            QVERIFY(end - begin == total / chunkCount || end - begin == total / chunkCount + 1);
+            previousEnd = end;
+
+            if (begin == end) {
+                continue;
+            }
+
+            // Stepping through the chunk reaches the first seed of the next
+            QVector<int> seed;
+            space.unrank(begin, seed);
+            for (quint64 rank = begin + 1; rank < end; ++rank) {
+                QVERIFY(space.next(seed));
+                QCOMPARE(space.rank(seed), rank);
+            }
+            QCOMPARE(space.next(seed), end < total);
+            if (end < total) {
+                QCOMPARE(space.rank(seed), end);
+            }
+        }
+        QCOMPARE(previousEnd, total);
+    }
+}
+
+void SeedSpaceTests::largeCount() {
+    // The largest central binomial coefficient within 64 bits
+    QVector<int> groups(67);
+    std::iota(groups.begin(), groups.end(), 0);
+
+    SeedSpace space;
+    space.reset(groups, 33);
+
+    QVERIFY(!space.isOverflow());
+    QCOMPARE(space.count(), Q_UINT64_C(14226520737620288370));
+
+    QVector<int> last;
+    space.unrank(space.count() - 1, last);
+    QVector<int> expected(33);
+    std::iota(expected.begin(), expected.end(), 34);
+    QCOMPARE(last, expected);
+    QCOMPARE(space.rank(last), space.count() - 1);
+    QVERIFY(!space.next(last));
+
+    QVector<int> seed;
+    const quint64 rank = space.count() / 3;
+    space.unrank(rank, seed);
+    QCOMPARE(space.rank(seed), rank);
+}
+
+void SeedSpaceTests::overflow() {
+    QVector<int> groups(100);
+    std::iota(groups.begin(), groups.end(), 0);
+
+    SeedSpace space;
+    space.reset(groups, 50);
+    QVERIFY(space.isOverflow());
+    QVERIFY(space.isValid());
+
+    // C(100, 50) = 100891344545564193334812497256
+    QVERIFY(qAbs(space.approxCount() / 1.00891344545564193e29 - 1) < 1e-12);
+
+    // The seeds are still enumerated
+    QVector<int> seed;
+    space.first(seed);
+    QCOMPARE(seed.size(), 50);
+    QVERIFY(space.next(seed));
+    QVERIFY(space.contains(seed));
+}
+
+QTEST_APPLESS_MAIN(SeedSpaceTests)
+#include "seedspace_tests.moc"
@@ -0,0 +1,66 @@
+###
+# Select the suites of the example library in a single run, and in three
+# shards that are merged, and check that the suites are identical.
+#
+# Variables:
+#   PROGRAM      path of the sigmaspectra executable
+#   EXAMPLE_DIR  directory of the example library and target
+#   WORK_DIR     scratch directory of the runs
+###
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+# Keep the settings of the user out of the runs
+set(ENV{XDG_CONFIG_HOME} ${WORK_DIR}/config)
+
+set(OPTIONS
+    --batch
+    --motion-path ${EXAMPLE_DIR}
+    --suite-size 5
+    --seed-size 2
+    --suite-count 10
+    ${EXAMPLE_DIR}/example-target.csv)
+
+function(run_batch)
+  execute_process(COMMAND ${PROGRAM} ${OPTIONS} ${ARGN}
+                  RESULT_VARIABLE result
+                  OUTPUT_VARIABLE output
+                  ERROR_VARIABLE output)
+  if (NOT result EQUAL 0)
+    message(FATAL_ERROR "Batch run failed: ${ARGN}\n${output}")
+  endif()
+endfunction()
+
+run_batch(--output ${WORK_DIR}/single)
+
+set(CHECKPOINTS)
+foreach (INDEX 1 2 3)
+  run_batch(--output ${WORK_DIR}/shard
+            --shard ${INDEX}/3
+            --checkpoint ${WORK_DIR}/shard-${INDEX}.json)
+  list(APPEND CHECKPOINTS --merge ${WORK_DIR}/shard-${INDEX}.json)
+endforeach()
+
+run_batch(--output ${WORK_DIR}/merged ${CHECKPOINTS})
+
+# The suite files hold the errors, the motions and their scale factors
+file(GLOB SINGLE RELATIVE ${WORK_DIR}/single ${WORK_DIR}/single/*.csv)
+file(GLOB MERGED RELATIVE ${WORK_DIR}/merged ${WORK_DIR}/merged/*.csv)
+
+if (NOT SINGLE)
+  message(FATAL_ERROR "No suites were selected.")
+endif()
+
+if (NOT "${SINGLE}" STREQUAL "${MERGED}")
+  message(FATAL_ERROR "The merged run saved other suites:\n${SINGLE}\n${MERGED}")
+endif()
+
+foreach (NAME ${SINGLE})
+  execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files
+                          ${WORK_DIR}/single/${NAME} ${WORK_DIR}/merged/${NAME}
+                  RESULT_VARIABLE result)
+  if (NOT result EQUAL 0)
+    message(FATAL_ERROR "The merged suite differs from the single run: ${NAME}")
+  endif()
+endforeach()